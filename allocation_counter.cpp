@@ -0,0 +1,104 @@
+
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018  Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Replaces the global operator new and delete to count heap allocations.
+ * Only built with -DWITH_ALLOCATION_COUNTER=ON; every allocation in the
+ * process then pays for two relaxed atomic adds.
+ */
+
+#include <cstdlib>
+#include <new>
+
+#include "pool_bench_memory.hpp"
+
+namespace
+{
+    inline void*
+    counted_allocate(std::size_t size)
+    {
+        pool_bench::memory::allocation_counter().fetch_add(1, std::memory_order_relaxed);
+        pool_bench::memory::byte_counter().fetch_add(size, std::memory_order_relaxed);
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    inline void*
+    counted_allocate_or_throw(std::size_t size)
+    {
+        while(true)
+        {
+            if(auto memory = counted_allocate(size))
+                return memory;
+            auto handler = std::get_new_handler();
+            if(!handler)
+                throw std::bad_alloc();
+            handler();
+        }
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    return counted_allocate_or_throw(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return counted_allocate_or_throw(size);
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept
+{
+    return counted_allocate(size);
+}
+
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept
+{
+    return counted_allocate(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::nothrow_t const&) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::nothrow_t const&) noexcept
+{
+    std::free(memory);
+}
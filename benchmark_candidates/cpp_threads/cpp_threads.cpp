@@ -20,6 +20,7 @@
 #include <cstdlib>
 #include <future>
 #include <functional>
+#include <thread>
 
 #include <pool_bench.hpp>
 
@@ -38,12 +39,26 @@ struct cpp_threads : pool_bench::runner
     void prepare() override {}
     void teardown() override {}
 
-    std::function<std::future<void>(std::function<void(void)>&&)>
+    pool_bench::async_function
     operator()() override
     {
-        return [](std::function<void(void)>&& f)
+        return [](pool_bench::task_function&& f)
                { return std::async(std::launch::async, std::move(f)); };
     }
+
+    /* Dropping a std::async future waits for the task, so posts get a detached thread */
+    void
+    post(pool_bench::task_function&& f) override
+    {
+        std::thread(std::move(f)).detach();
+    }
+
+    /* A thread of its own, as std::async would start, minus its future */
+    void
+    submit_packaged(pool_bench::task_function&& f, pool_bench::priority) override
+    {
+        std::thread(std::move(f)).detach();
+    }
 };
 
 REGISTER_RUNNER(cpp_threads)
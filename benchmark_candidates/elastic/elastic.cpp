@@ -0,0 +1,101 @@
+/* 
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018  Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pool_bench.hpp>
+
+#include "elastic.hpp"
+
+namespace elastic
+{
+    namespace internal 
+    { 
+        std::unique_ptr<task_system> sys;
+
+        void push_queue(pool_bench::task_function&& f, pool_bench::priority level)
+        {
+            sys->push(std::move(f), level);
+        }
+    }
+
+    struct elastic_pool : pool_bench::runner
+    {
+        char const*
+        name() override
+        { return "Elastic"; }
+
+        void prepare() override
+        { internal::sys = std::make_unique<internal::task_system>(); }
+
+        void teardown() override
+        { internal::sys = nullptr; }
+
+        pool_bench::scheduler_stats
+        stats() override
+        { return internal::sys ? internal::sys->stats() : pool_bench::scheduler_stats(); }
+
+        bool takes_worker_count() override
+        { return true; }
+
+        long threads() override
+        { return internal::sys ? internal::sys->live_workers() : 0; }
+
+        void reset_stats() override
+        {
+            if(internal::sys)
+                internal::sys->reset_stats();
+        }
+
+        size_t
+        cancel_pending() override
+        { return internal::sys ? internal::sys->drain() : 0; }
+
+        void
+        post(pool_bench::task_function&& f) override
+        { internal::sys->push(std::move(f)); }
+
+        /* The packaged task goes on the queue as async_at() would put its own */
+        void
+        submit_packaged(pool_bench::task_function&& f, pool_bench::priority level) override
+        { internal::push_queue(std::move(f), level); }
+
+        /* Helpers beyond the live workers grow the pool through the backlog */
+        void
+        parallel_for(size_t begin, size_t end, size_t grain,
+                     pool_bench::range_function const& body) override
+        {
+            pool_bench::shared_range_for([](pool_bench::task_function&& f)
+                                         { internal::sys->push(std::move(f)); },
+                                         internal::sys->max_workers(), begin, end, grain, body);
+        }
+
+        pool_bench::async_function
+        operator()() override
+        {
+            return [](pool_bench::task_function&& f)
+                   { return elastic::async(std::move(f)); };
+        }
+
+        pool_bench::async_function
+        at_priority(pool_bench::priority level) override
+        {
+            return [level](pool_bench::task_function&& f)
+                   { return elastic::async_at(level, std::move(f)); };
+        }
+    };
+    REGISTER_RUNNER(elastic_pool)
+}
@@ -0,0 +1,310 @@
+/* 
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018  Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <pool_bench.hpp>
+
+namespace elastic
+{
+    namespace internal{
+        using lock_t = std::unique_lock<std::mutex>; 
+        using clock = std::chrono::steady_clock;
+
+        /*
+         * One shared queue served by as many threads as the load needs,
+         * none when the pool is idle. A push starts a thread when no
+         * worker is idle and either the backlog passes _grow_depth tasks
+         * per worker or the oldest task has waited _grow_wait; a worker
+         * idle for _idle_timeout exits. Threads are detached, and the
+         * destructor waits for the last of them to leave. Each thread
+         * borrows one of _max counter slots for its lifetime, so a slot's
+         * counters add up the threads that held it.
+         */
+        class task_system
+        {
+            struct queued
+            {
+                pool_bench::task_function f;
+                clock::time_point enqueued;
+            };
+
+            unsigned const _max;
+            size_t const _grow_depth;
+            clock::duration const _grow_wait;
+            clock::duration const _idle_timeout;
+
+            std::mutex _mutex;
+            std::condition_variable _ready;
+            std::condition_variable _exited;
+            /* One deque per priority level, the highest served first */
+            std::deque<queued> _q[pool_bench::priority_levels];
+            size_t _depth = 0;
+            size_t _peak = 0;
+            unsigned _live = 0;
+            unsigned _idle = 0;
+            bool _done = false;
+            std::vector<pool_bench::worker_counters> _counters;
+            std::vector<unsigned> _free_slots;
+
+            /* Oldest task of the highest non-empty level, called with _mutex held */
+            inline pool_bench::task_function
+            take()
+            {
+                for(size_t n = pool_bench::priority_levels; n-- != 0;)
+                {
+                    if(!_q[n].empty())
+                    {
+                        auto f = std::move(_q[n].front().f);
+                        _q[n].pop_front();
+                        --_depth;
+                        return f;
+                    }
+                }
+                return nullptr;
+            }
+
+            /* How long the longest queued task has waited, called with _mutex held */
+            inline clock::duration
+            longest_wait() const
+            {
+                auto oldest = clock::time_point::max();
+                for(auto& e : _q)
+                {
+                    if(!e.empty())
+                        oldest = std::min(oldest, e.front().enqueued);
+                }
+                return _depth == 0 ? clock::duration::zero() : clock::now() - oldest;
+            }
+
+            /* Starts a worker if the queue outgrew the live ones, called with _mutex held */
+            inline void
+            grow()
+            {
+                if(_done)
+                    return;
+                if(_live != 0 && (_idle != 0 || _live >= _max))
+                    return;
+                if(_live != 0
+                   && _depth <= _grow_depth * _live
+                   && longest_wait() < _grow_wait)
+                    return;
+
+                auto slot = _free_slots.back();
+                _free_slots.pop_back();
+                ++_live;
+                try
+                {
+                    std::thread([this, slot]{ run(slot); }).detach();
+                }
+                catch(std::system_error const&)
+                {
+                    /* Out of threads; the ones running will get to the task */
+                    _free_slots.push_back(slot);
+                    if(--_live == 0)
+                        throw;
+                }
+            }
+
+            inline void
+            run(unsigned slot)
+            {
+                auto& counters = _counters[slot];
+                lock_t lock{_mutex};
+                while(true)
+                {
+                    if(_depth == 0)
+                    {
+                        if(_done)
+                            break;
+                        ++_idle;
+                        auto start = clock::now();
+                        bool woken = _ready.wait_for(lock, _idle_timeout,
+                                                     [this]{ return _depth != 0 || _done; });
+                        auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            clock::now() - start);
+                        pool_bench::worker_counters::bump(counters.blocked, waited.count());
+                        --_idle;
+                        if(!woken)
+                            break;
+                        continue;
+                    }
+
+                    auto f = take();
+                    grow();
+                    lock.unlock();
+                    pool_bench::worker_counters::bump(counters.executed);
+                    f();
+                    f = nullptr;
+                    lock.lock();
+                }
+                _free_slots.push_back(slot);
+                --_live;
+                _exited.notify_all();
+            }
+
+        public:
+            inline task_system()
+                : _max(pool_bench::worker_count()),
+                  _grow_depth(2),
+                  _grow_wait(std::chrono::milliseconds(1)),
+                  _idle_timeout(std::chrono::milliseconds(10)),
+                  _counters(_max)
+            {
+                for(unsigned n = _max; n-- != 0;)
+                    _free_slots.push_back(n);
+            }
+
+            /* Queued tasks still run before the last worker leaves */
+            inline ~task_system()
+            {
+                lock_t lock{_mutex};
+                _done = true;
+                _ready.notify_all();
+                _exited.wait(lock, [this]{ return _live == 0; });
+            }
+
+            /* Throws std::system_error, with f dropped again, when the pool
+             * has no worker and cannot start one */
+            inline void
+            push(pool_bench::task_function&& f,
+                 pool_bench::priority level = pool_bench::priority::normal)
+            {
+                {
+                    lock_t lock{_mutex};
+                    auto& q = _q[static_cast<size_t>(level)];
+                    q.push_back({std::move(f), clock::now()});
+                    ++_depth;
+                    _peak = std::max(_peak, _depth);
+                    try
+                    {
+                        grow();
+                    }
+                    catch(std::system_error const&)
+                    {
+                        /* No worker to take it; nobody else has seen it either */
+                        q.pop_back();
+                        --_depth;
+                        throw;
+                    }
+                }
+                _ready.notify_one();
+            }
+
+            /* Removes every queued task; they are destroyed outside the lock,
+             * which breaks their promises */
+            inline size_t
+            drain()
+            {
+                std::deque<queued> dropped[pool_bench::priority_levels];
+                size_t count = 0;
+                {
+                    lock_t lock{_mutex};
+                    for(size_t n = 0; n != pool_bench::priority_levels; ++n)
+                        dropped[n].swap(_q[n]);
+                    count = _depth;
+                    _depth = 0;
+                }
+                return count;
+            }
+
+            inline unsigned
+            max_workers() const
+            {
+                return _max;
+            }
+
+            inline unsigned
+            live_workers()
+            {
+                lock_t lock{_mutex};
+                return _live;
+            }
+
+            /* Every slot reports the one queue's peak depth */
+            inline pool_bench::scheduler_stats
+            stats()
+            {
+                lock_t lock{_mutex};
+                pool_bench::scheduler_stats result;
+                for(auto& e : _counters)
+                    result.workers.push_back(e.snapshot(_peak));
+                return result;
+            }
+
+            inline void
+            reset_stats()
+            {
+                lock_t lock{_mutex};
+                for(auto& e : _counters)
+                    e.reset();
+                _peak = _depth;
+            }
+        };
+
+        void
+        push_queue(pool_bench::task_function&& f,
+                   pool_bench::priority level = pool_bench::priority::normal);
+    }
+    
+    template<typename F, typename... Args>
+    decltype(auto)
+    async(F&& f, Args&&... args)
+    {
+        using result_type = std::result_of_t<std::decay_t<F>(std::decay_t<Args>...)>;
+        using packaged_type = std::packaged_task<result_type()>;
+
+        auto task = packaged_type(std::bind(std::forward<F>(f),
+                                            std::forward<Args>(args)...));
+        auto result = task.get_future();
+
+        internal::push_queue([task = std::move(task)]() mutable
+                             {
+                                 task();
+                             });
+        return result;
+    }
+
+    /* async() of a nullary task at the given priority */
+    template<typename F>
+    decltype(auto)
+    async_at(pool_bench::priority level, F&& f)
+    {
+        using result_type = std::result_of_t<std::decay_t<F>()>;
+        using packaged_type = std::packaged_task<result_type()>;
+
+        auto task = packaged_type(std::forward<F>(f));
+        auto result = task.get_future();
+
+        internal::push_queue([task = std::move(task)]() mutable
+                             {
+                                 task();
+                             },
+                             level);
+        return result;
+    }
+}
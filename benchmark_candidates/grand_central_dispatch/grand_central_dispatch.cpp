@@ -36,12 +36,60 @@ namespace dispatch
         void teardown() override
         {}
 
-        std::function<std::future<void>(std::function<void(void)>&&)>
+        pool_bench::async_function
         operator()() override
         {
-            return [](std::function<void(void)>&& f)
+            return [](pool_bench::task_function&& f)
                    { return dispatch::async(std::move(f)); };
         }
+
+        static long
+        queue_priority(pool_bench::priority level)
+        {
+            return level == pool_bench::priority::high ? DISPATCH_QUEUE_PRIORITY_HIGH
+                : level == pool_bench::priority::low ? DISPATCH_QUEUE_PRIORITY_LOW
+                : DISPATCH_QUEUE_PRIORITY_DEFAULT;
+        }
+
+        pool_bench::async_function
+        at_priority(pool_bench::priority level) override
+        {
+            long queue = queue_priority(level);
+            return [queue](pool_bench::task_function&& f)
+                   { return dispatch::async_at(queue, std::move(f)); };
+        }
+
+        /* Straight onto a global queue, without a packaged_task */
+        static void
+        dispatch_task(long queue, pool_bench::task_function&& f)
+        {
+            dispatch_async_f(dispatch_get_global_queue(queue, 0),
+                             new pool_bench::task_function(std::move(f)),
+                             [](void* f){
+                                 auto f_ = static_cast<pool_bench::task_function*>(f);
+                                 (*f_)();
+                                 delete f_;
+                             });
+        }
+
+        void
+        post(pool_bench::task_function&& f) override
+        {
+            dispatch_task(DISPATCH_QUEUE_PRIORITY_DEFAULT, std::move(f));
+        }
+
+        void
+        submit_packaged(pool_bench::task_function&& f, pool_bench::priority level) override
+        {
+            dispatch_task(queue_priority(level), std::move(f));
+        }
+
+        void
+        parallel_for(size_t begin, size_t end, size_t grain,
+                     pool_bench::range_function const& body) override
+        {
+            dispatch::apply(begin, end, grain, body);
+        }
     };
     REGISTER_RUNNER(grand_central_dispatch)
 }
@@ -20,6 +20,7 @@
 #ifndef _POOL_BENCH_GRAND_CENTRAL_DISPATCH_HPP_
 #define _POOL_BENCH_GRAND_CENTRAL_DISPATCH_HPP_
 
+#include <algorithm>
 #include <functional>
 #include <future>
 #include <type_traits>
@@ -28,9 +29,10 @@
 
 namespace dispatch
 {
+    /* Submits to the global concurrent queue of the given DISPATCH_QUEUE_PRIORITY_* */
     template<typename F, typename... Args>
     decltype(auto)
-    async(F&& f, Args&&... args)
+    async_at(long queue_priority, F&& f, Args&&... args)
     {
         using result_type = std::result_of_t<std::decay_t<F>(std::decay_t<Args>...)>;
         using packaged_type = std::packaged_task<result_type()>;
@@ -39,7 +41,7 @@ namespace dispatch
                                                std::forward<Args>(args)...));
         auto result = ptr->get_future();
 
-        dispatch_async_f(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+        dispatch_async_f(dispatch_get_global_queue(queue_priority, 0),
                          ptr,
                          [](void* f){
                              packaged_type* f_ = static_cast<packaged_type*>(f);
@@ -48,6 +50,45 @@ namespace dispatch
                          });
         return result;
     }
+
+    /*
+     * dispatch_apply over [begin, end) in chunks of grain on the default
+     * global queue. The calling thread runs chunks as well and returns
+     * once all of them have run.
+     */
+    template<typename F>
+    void
+    apply(size_t begin, size_t end, size_t grain, F& body)
+    {
+        if(begin >= end)
+            return;
+        grain = std::max<size_t>(grain, 1);
+
+        struct chunks
+        {
+            F& body;
+            size_t begin;
+            size_t end;
+            size_t grain;
+        } loop{body, begin, end, grain};
+
+        dispatch_apply_f((end - begin + grain - 1) / grain,
+                         dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0),
+                         &loop,
+                         [](void* context, size_t i){
+                             chunks* loop_ = static_cast<chunks*>(context);
+                             size_t first = loop_->begin + i * loop_->grain;
+                             loop_->body(first, std::min(first + loop_->grain, loop_->end));
+                         });
+    }
+
+    template<typename F, typename... Args>
+    decltype(auto)
+    async(F&& f, Args&&... args)
+    {
+        return async_at(DISPATCH_QUEUE_PRIORITY_DEFAULT,
+                        std::forward<F>(f), std::forward<Args>(args)...);
+    }
 }
 
 #endif
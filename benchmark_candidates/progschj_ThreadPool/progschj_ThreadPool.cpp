@@ -35,7 +35,7 @@ namespace progschj
 
         void prepare() override
         {
-            _pool = std::make_unique<ThreadPool>(4);
+            _pool = std::make_unique<ThreadPool>(pool_bench::worker_count(4));
         }
 
         void teardown() override
@@ -43,10 +43,16 @@ namespace progschj
             _pool = nullptr;
         }
 
-        std::function<std::future<void>(std::function<void(void)>&&)>
+        bool takes_worker_count() override
+        { return true; }
+
+        long threads() override
+        { return _pool ? pool_bench::worker_count(4) : 0; }
+
+        pool_bench::async_function
         operator()() override
         {
-            return [this](std::function<void(void)>&& f)
+            return [this](pool_bench::task_function&& f)
                    { return _pool->enqueue(std::move(f)); };
         }
     };
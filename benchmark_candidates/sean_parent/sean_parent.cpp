@@ -29,9 +29,9 @@ namespace sparent_naive
     { 
         std::unique_ptr<task_system> sys;
 
-        void push_queue(std::function<void()>&& f)
+        void push_queue(pool_bench::task_function&& f, pool_bench::priority level)
         {
-            sys->push(std::move(f));
+            sys->push(std::move(f), level);
         }
     }
 
@@ -51,12 +51,58 @@ namespace sparent_naive
         void teardown() override
         { internal::sys = nullptr; }
 
-        std::function<std::future<void>(std::function<void(void)>&&)>
+        pool_bench::scheduler_stats
+        stats() override
+        { return internal::sys ? internal::sys->stats() : pool_bench::scheduler_stats(); }
+
+        bool takes_worker_count() override
+        { return true; }
+
+        long threads() override
+        { return internal::sys ? pool_bench::worker_count() : 0; }
+
+        void reset_stats() override
+        {
+            if(internal::sys)
+                internal::sys->reset_stats();
+        }
+
+        size_t
+        cancel_pending() override
+        { return internal::sys ? internal::sys->drain() : 0; }
+
+        void
+        post(pool_bench::task_function&& f) override
+        { internal::sys->push(std::move(f)); }
+
+        /* The packaged task goes on the queue as async_at() would put its own */
+        void
+        submit_packaged(pool_bench::task_function&& f, pool_bench::priority level) override
+        { internal::push_queue(std::move(f), level); }
+
+        /* A helper task per worker sharing a chunk cursor with the caller */
+        void
+        parallel_for(size_t begin, size_t end, size_t grain,
+                     pool_bench::range_function const& body) override
+        {
+            pool_bench::shared_range_for([](pool_bench::task_function&& f)
+                                         { internal::sys->push(std::move(f)); },
+                                         pool_bench::worker_count(), begin, end, grain, body);
+        }
+
+        pool_bench::async_function
         operator()() override
         {
-            return [](std::function<void(void)>&& f)
+            return [](pool_bench::task_function&& f)
                    { return sparent_naive::async(std::move(f)); };
         }
+
+        pool_bench::async_function
+        at_priority(pool_bench::priority level) override
+        {
+            return [level](pool_bench::task_function&& f)
+                   { return sparent_naive::async_at(level, std::move(f)); };
+        }
     };
     REGISTER_RUNNER(sparent_naive_runner)
 }
@@ -68,9 +114,9 @@ namespace sparent_multiqueue
     { 
         std::unique_ptr<task_system> sys;
 
-        void push_queue(std::function<void()>&& f)
+        void push_queue(pool_bench::task_function&& f, pool_bench::priority level)
         {
-            sys->push(std::move(f));
+            sys->push(std::move(f), level);
         }
     }
 
@@ -86,12 +132,57 @@ namespace sparent_multiqueue
         void teardown() override
         { internal::sys = nullptr; }
 
-        std::function<std::future<void>(std::function<void(void)>&&)>
+        pool_bench::scheduler_stats
+        stats() override
+        { return internal::sys ? internal::sys->stats() : pool_bench::scheduler_stats(); }
+
+        bool takes_worker_count() override
+        { return true; }
+
+        long threads() override
+        { return internal::sys ? pool_bench::worker_count() : 0; }
+
+        void reset_stats() override
+        {
+            if(internal::sys)
+                internal::sys->reset_stats();
+        }
+
+        size_t
+        cancel_pending() override
+        { return internal::sys ? internal::sys->drain() : 0; }
+
+        void
+        post(pool_bench::task_function&& f) override
+        { internal::sys->push_local(std::move(f)); }
+
+        /* The packaged task goes on the queue as async_at() would put its own */
+        void
+        submit_packaged(pool_bench::task_function&& f, pool_bench::priority level) override
+        { internal::push_queue(std::move(f), level); }
+
+        void
+        parallel_for(size_t begin, size_t end, size_t grain,
+                     pool_bench::range_function const& body) override
+        {
+            pool_bench::shared_range_for([](pool_bench::task_function&& f)
+                                         { internal::sys->push(std::move(f)); },
+                                         pool_bench::worker_count(), begin, end, grain, body);
+        }
+
+        pool_bench::async_function
         operator()() override
         {
-            return [](std::function<void(void)>&& f)
+            return [](pool_bench::task_function&& f)
                    { return sparent_multiqueue::async(std::move(f)); };
         }
+
+        pool_bench::async_function
+        at_priority(pool_bench::priority level) override
+        {
+            return [level](pool_bench::task_function&& f)
+                   { return sparent_multiqueue::async_at(level, std::move(f)); };
+        }
     };
     REGISTER_RUNNER(sean_parent_multiqueue)
 }
@@ -102,9 +193,9 @@ namespace sparent_worksteal
     { 
         std::unique_ptr<task_system> sys;
 
-        void push_queue(std::function<void()>&& f)
+        void push_queue(pool_bench::task_function&& f, pool_bench::priority level)
         {
-            sys->push(std::move(f));
+            sys->push(std::move(f), level);
         }
     }
 
@@ -120,13 +211,57 @@ namespace sparent_worksteal
         void teardown() override
         { internal::sys = nullptr; }
 
+        pool_bench::scheduler_stats
+        stats() override
+        { return internal::sys ? internal::sys->stats() : pool_bench::scheduler_stats(); }
+
+        bool takes_worker_count() override
+        { return true; }
+
+        long threads() override
+        { return internal::sys ? pool_bench::worker_count() : 0; }
+
+        void reset_stats() override
+        {
+            if(internal::sys)
+                internal::sys->reset_stats();
+        }
+
+        size_t
+        cancel_pending() override
+        { return internal::sys ? internal::sys->drain() : 0; }
 
-        std::function<std::future<void>(std::function<void(void)>&&)>
+        void
+        post(pool_bench::task_function&& f) override
+        { internal::sys->push_local(std::move(f)); }
+
+        /* The packaged task goes on the queue as async_at() would put its own */
+        void
+        submit_packaged(pool_bench::task_function&& f, pool_bench::priority level) override
+        { internal::push_queue(std::move(f), level); }
+
+        void
+        parallel_for(size_t begin, size_t end, size_t grain,
+                     pool_bench::range_function const& body) override
+        {
+            pool_bench::shared_range_for([](pool_bench::task_function&& f)
+                                         { internal::sys->push(std::move(f)); },
+                                         pool_bench::worker_count(), begin, end, grain, body);
+        }
+
+        pool_bench::async_function
         operator()() override
         {
-            return [](std::function<void(void)>&& f)
+            return [](pool_bench::task_function&& f)
                    { return sparent_worksteal::async(std::move(f)); };
         }
+
+        pool_bench::async_function
+        at_priority(pool_bench::priority level) override
+        {
+            return [level](pool_bench::task_function&& f)
+                   { return sparent_worksteal::async_at(level, std::move(f)); };
+        }
     };
     REGISTER_RUNNER(sean_parent_worksteal)
 }
@@ -17,6 +17,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <deque>
 #include <functional>
@@ -26,18 +28,97 @@
 #include <thread>
 #include <vector>
 
+#include <pool_bench.hpp>
+
 namespace sparent_multiqueue
 {
     namespace internal{
         using lock_t = std::unique_lock<std::mutex>; 
 
         class notification_queue {
-            std::deque<std::function<void()>> _q;
+            /* One deque per priority level, the highest served first */
+            std::deque<pool_bench::task_function> _q[pool_bench::priority_levels];
             bool _done = false;
             std::mutex _mutex;
             std::condition_variable _ready;
+            std::atomic<size_t> _peak{0};
+
+            /* Called with _mutex held after every push */
+            inline void
+            track_depth()
+            {
+                if(depth() > _peak.load(std::memory_order_relaxed))
+                    _peak.store(depth(), std::memory_order_relaxed);
+            }
+
+            /* Tasks queued over all levels, called with _mutex held */
+            inline size_t
+            depth() const
+            {
+                size_t total = 0;
+                for(auto& e : _q)
+                    total += e.size();
+                return total;
+            }
+
+            inline bool
+            empty() const
+            {
+                for(auto& e : _q)
+                {
+                    if(!e.empty())
+                        return false;
+                }
+                return true;
+            }
+
+            /* Oldest task of the highest non-empty level, called with _mutex held */
+            inline bool
+            take(pool_bench::task_function& x)
+            {
+                for(size_t n = pool_bench::priority_levels; n-- != 0;)
+                {
+                    if(!_q[n].empty())
+                    {
+                        x = std::move(_q[n].front());
+                        _q[n].pop_front();
+                        return true;
+                    }
+                }
+                return false;
+            }
 
         public:
+            inline size_t
+            peak() const
+            {
+                return _peak.load(std::memory_order_relaxed);
+            }
+
+            inline void
+            reset_peak()
+            {
+                _peak.store(0, std::memory_order_relaxed);
+            }
+
+            /* Removes every queued task; they are destroyed outside the lock,
+             * which breaks their promises */
+            inline size_t
+            drain()
+            {
+                std::deque<pool_bench::task_function> dropped[pool_bench::priority_levels];
+                size_t count = 0;
+                {
+                    lock_t lock{_mutex};
+                    for(size_t n = 0; n != pool_bench::priority_levels; ++n)
+                    {
+                        count += _q[n].size();
+                        dropped[n].swap(_q[n]);
+                    }
+                }
+                return count;
+            }
+
             inline void
             done()
             {
@@ -49,26 +130,29 @@ namespace sparent_multiqueue
             }
 
             inline bool
-            pop(std::function<void()>& x)
+            pop(pool_bench::task_function& x, pool_bench::worker_counters& counters)
             {
                 lock_t lock{_mutex};
-                while(_q.empty() && !_done)
+                if(empty() && !_done)
                 {
-                    _ready.wait(lock);
+                    auto start = std::chrono::steady_clock::now();
+                    while(empty() && !_done)
+                    {
+                        _ready.wait(lock);
+                    }
+                    auto waited = std::chrono::steady_clock::now() - start;
+                    pool_bench::worker_counters::bump(counters.blocked, waited.count());
                 }
-                if(_q.empty())
-                    return false;
-                x = move(_q.front());
-                _q.pop_front();
-                return true;
+                return take(x);
             }
 
             inline void
-            push(std::function<void()>&& f)
+            push(pool_bench::task_function&& f, pool_bench::priority level)
             {
                 {
                     lock_t lock{_mutex};
-                    _q.emplace_back(std::move(f));
+                    _q[static_cast<size_t>(level)].emplace_back(std::move(f));
+                    track_depth();
                 }
                 _ready.notify_one();
             }
@@ -76,29 +160,49 @@ namespace sparent_multiqueue
 
         class task_system
         {
+            /* The pool and worker index of the calling thread, if it is a worker */
+            struct worker_slot
+            {
+                task_system const* system = nullptr;
+                unsigned index = 0;
+            };
+
+            static inline worker_slot&
+            local()
+            {
+                static thread_local worker_slot slot;
+                return slot;
+            }
+
             unsigned const _count;
             std::vector<std::thread> _threads;
             std::vector<notification_queue> _q;
             std::atomic<unsigned> _index;
+            std::vector<pool_bench::worker_counters> _counters;
 
             inline void
             run(unsigned i)
             {
+                local() = worker_slot{this, i};
                 while(true)
                 {
-                    std::function<void()> f;
-                    if(!f && !_q[i].pop(f))
+                    pool_bench::task_function f;
+                    if(!f && !_q[i].pop(f, _counters[i]))
                         break;
+                    pool_bench::worker_counters::bump(_counters[i].executed);
+                    /* Workers only ever take from their own queue */
+                    pool_bench::running_stolen() = 0;
                     f();
                 }
             }
 
         public:
             inline task_system()
-                : _count(std::thread::hardware_concurrency()),
+                : _count(pool_bench::worker_count()),
                   _threads(),
                   _q(_count),
-                  _index(0)
+                  _index(0),
+                  _counters(_count)
             {
                 for(unsigned n = 0; n != _count; ++n)
                     _threads.emplace_back([this, n]{ run(n); });
@@ -113,15 +217,56 @@ namespace sparent_multiqueue
             }
 
             inline void
-            push(std::function<void()>&& f)
+            push(pool_bench::task_function&& f,
+                 pool_bench::priority level = pool_bench::priority::normal)
             {
                 auto i = _index++;
-                _q[i % _count].push(std::move(f));
+                _q[i % _count].push(std::move(f), level);
+            }
+
+            /* Queues a continuation on the worker that releases it, where its
+             * input is likely still in cache; elsewhere like push() */
+            inline void
+            push_local(pool_bench::task_function&& f)
+            {
+                auto& worker = local();
+                if(worker.system != this)
+                    return push(std::move(f));
+                _q[worker.index].push(std::move(f), pool_bench::priority::normal);
+            }
+
+            inline size_t
+            drain()
+            {
+                size_t count = 0;
+                for(auto& e : _q)
+                    count += e.drain();
+                return count;
+            }
+
+            inline pool_bench::scheduler_stats
+            stats() const
+            {
+                pool_bench::scheduler_stats result;
+                for(unsigned n = 0; n != _count; ++n)
+                    result.workers.push_back(_counters[n].snapshot(_q[n].peak()));
+                return result;
+            }
+
+            inline void
+            reset_stats()
+            {
+                for(unsigned n = 0; n != _count; ++n)
+                {
+                    _counters[n].reset();
+                    _q[n].reset_peak();
+                }
             }
         };
 
         void
-        push_queue(std::function<void()>&& f);
+        push_queue(pool_bench::task_function&& f,
+                   pool_bench::priority level = pool_bench::priority::normal);
     }
     
     template<typename F, typename... Args>
@@ -131,15 +276,33 @@ namespace sparent_multiqueue
         using result_type = std::result_of_t<std::decay_t<F>(std::decay_t<Args>...)>;
         using packaged_type = std::packaged_task<result_type()>;
 
-        auto ptr = new packaged_type(std::bind(std::forward<F>(f),
-                                               std::forward<Args>(args)...));
-        auto result = ptr->get_future();
+        auto task = packaged_type(std::bind(std::forward<F>(f),
+                                            std::forward<Args>(args)...));
+        auto result = task.get_future();
 
-        internal::push_queue([ptr]
+        internal::push_queue([task = std::move(task)]() mutable
                              {
-                                 (*ptr)();
-                                 delete ptr;
+                                 task();
                              });
         return result;
     }
+
+    /* async() of a nullary task at the given priority */
+    template<typename F>
+    decltype(auto)
+    async_at(pool_bench::priority level, F&& f)
+    {
+        using result_type = std::result_of_t<std::decay_t<F>()>;
+        using packaged_type = std::packaged_task<result_type()>;
+
+        auto task = packaged_type(std::forward<F>(f));
+        auto result = task.get_future();
+
+        internal::push_queue([task = std::move(task)]() mutable
+                             {
+                                 task();
+                             },
+                             level);
+        return result;
+    }
 }
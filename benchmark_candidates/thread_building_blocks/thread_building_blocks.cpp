@@ -18,6 +18,7 @@
  */
 
 #include <cstdlib>
+#include <memory>
 
 #include <pool_bench.hpp>
 #include "thread_building_blocks.hpp"
@@ -26,22 +27,70 @@ namespace pool_bench_tbb
 {
     struct tbb : pool_bench::runner
     {
+        /* Only under --workers; TBB sizes itself to the cores otherwise */
+        std::unique_ptr<::tbb::task_scheduler_init> _init;
+
         char const*
         name() override
         { return "Thread Building Blocks"; }
 
         void prepare() override
-        {}
+        {
+            if(pool_bench::worker_override() != 0)
+                _init = std::make_unique<::tbb::task_scheduler_init>(
+                    static_cast<int>(pool_bench::worker_override()));
+        }
 
         void teardown() override
-        {}
+        {
+            _init = nullptr;
+        }
+
+        bool takes_worker_count() override
+        { return true; }
 
-        std::function<std::future<void>(std::function<void(void)>&&)>
+        pool_bench::async_function
         operator()() override
         {
-            return [](std::function<void(void)>&& f)
+            return [](pool_bench::task_function&& f)
                    { return pool_bench_tbb::async(std::move(f)); };
         }
+
+        static ::tbb::priority_t
+        native_priority(pool_bench::priority level)
+        {
+            return level == pool_bench::priority::high ? ::tbb::priority_high
+                : level == pool_bench::priority::low ? ::tbb::priority_low
+                : ::tbb::priority_normal;
+        }
+
+        pool_bench::async_function
+        at_priority(pool_bench::priority level) override
+        {
+            auto native = native_priority(level);
+            return [native](pool_bench::task_function&& f)
+                   { return pool_bench_tbb::async_at(native, std::move(f)); };
+        }
+
+        void
+        post(pool_bench::task_function&& f) override
+        {
+            pool_bench_tbb::post(std::move(f));
+        }
+
+        /* A root task of its own, without async_at()'s second packaged_task */
+        void
+        submit_packaged(pool_bench::task_function&& f, pool_bench::priority level) override
+        {
+            pool_bench_tbb::post(std::move(f), native_priority(level));
+        }
+
+        void
+        parallel_for(size_t begin, size_t end, size_t grain,
+                     pool_bench::range_function const& body) override
+        {
+            pool_bench_tbb::parallel_for(begin, end, grain, body);
+        }
     };
     REGISTER_RUNNER(tbb)
 }
@@ -20,21 +20,26 @@
 #ifndef _POOL_BENCH_TBB_HPP_
 #define _POOL_BENCH_TBB_HPP_
 
+#include <algorithm>
 #include <functional>
 #include <future>
 #include <type_traits>
 #include <iostream>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 #include <tbb/task.h>
+#include <tbb/task_scheduler_init.h>
 
 namespace pool_bench_tbb
 {
     template <typename TASK>
     using operator_return_t = typename std::result_of<TASK()>::type;
 
+    /* Enqueues a root task at the given tbb::priority_t */
     template<typename F, typename... Args>
     decltype(auto)
-    async(F&& f, Args&&... args)
+    async_at(tbb::priority_t level, F&& f, Args&&... args)
     {
         struct LocalTBBTask : public tbb::task
         {
@@ -63,9 +68,54 @@ namespace pool_bench_tbb
                 delete ptr;
             });
 
-        tbb::task::enqueue(*tbbNode);
+        tbb::task::enqueue(*tbbNode, level);
         return result;
     }
+
+    /* Enqueues a root task without a packaged_task, for tasks nobody waits
+     * on or that settle their own future */
+    template<typename F>
+    void
+    post(F&& f, tbb::priority_t level = tbb::priority_normal)
+    {
+        struct PostedTBBTask : public tbb::task
+        {
+            std::decay_t<F> func;
+
+            PostedTBBTask(F&& f) : func(std::forward<F>(f))
+            {}
+
+            tbb::task* execute() override
+            {
+                func();
+                return nullptr;
+            }
+        };
+
+        auto* tbbNode = new (tbb::task::allocate_root()) PostedTBBTask(std::forward<F>(f));
+        tbb::task::enqueue(*tbbNode, level);
+    }
+
+    /* tbb::parallel_for with its default auto_partitioner, which splits the
+     * range no finer than grain, and further only as idle threads steal */
+    template<typename F>
+    void
+    parallel_for(size_t begin, size_t end, size_t grain, F&& body)
+    {
+        tbb::parallel_for(tbb::blocked_range<size_t>(begin, end, std::max<size_t>(grain, 1)),
+                          [&body](tbb::blocked_range<size_t> const& range)
+                          {
+                              body(range.begin(), range.end());
+                          });
+    }
+
+    template<typename F, typename... Args>
+    decltype(auto)
+    async(F&& f, Args&&... args)
+    {
+        return async_at(tbb::priority_normal,
+                        std::forward<F>(f), std::forward<Args>(args)...);
+    }
 }
 
 #endif
@@ -0,0 +1,239 @@
+
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018  Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <pool_bench.hpp>
+
+namespace chrono = std::chrono;
+using namespace std::string_literals;
+
+/*
+ * A stream of CPU bound tasks where a fraction of the tasks block the worker
+ * they land on, either in poll() on a pipe that never becomes readable (a
+ * stand-in for a slow disk or socket) or in a timed sleep.
+ * Pools with a fixed number of workers lose those workers for the duration
+ * of the block, which shows up as CPU tasks waiting in the queue.
+ * The blocking share is a percentage, one suite per share.
+ */
+struct blocking_io : public pool_bench::suite
+{
+    size_t _task_count;
+    double _blocking_fraction;
+    std::string _name;
+    chrono::milliseconds _block_time;
+    size_t _cpu_iterations;
+
+    int _pipe[2];
+    std::vector<double> _results;
+    std::vector<double> _answer;
+    std::vector<chrono::nanoseconds> _cpu_wait;
+    std::vector<chrono::nanoseconds> _cpu_busy;
+    std::atomic<size_t> _blocked;
+    chrono::nanoseconds _span;
+
+    blocking_io(unsigned percent = 25)
+        :_task_count(4096),
+         _blocking_fraction(percent / 100.0),
+         _name("blocking io (" + std::to_string(percent) + "%)"),
+         _block_time(1),
+         _cpu_iterations(20000),
+         _pipe{-1, -1},
+         _results(_task_count),
+         _answer(_task_count),
+         _cpu_wait(_task_count),
+         _cpu_busy(_task_count),
+         _blocked(0),
+         _span(0)
+    {}
+
+    size_t
+    problem_size() override
+    {
+        return _task_count;
+    }
+
+    char const*
+    name() override
+    {
+        return _name.c_str();
+    }
+
+    /* Spreads the blocking tasks evenly over the submission order */
+    bool
+    is_blocking(size_t i) const
+    {
+        return std::floor((i + 1) * _blocking_fraction)
+            > std::floor(i * _blocking_fraction);
+    }
+
+    bool check_result() override
+    {
+        size_t blocking = 0;
+        for(size_t i = 0; i < _task_count; ++i)
+        {
+            if(is_blocking(i))
+                ++blocking;
+            else if(_results[i] != _answer[i])
+                return false;
+        }
+        return _blocked.load() == blocking;
+    }
+
+    void prepare() override
+    {
+        if(::pipe(_pipe) != 0)
+            throw std::runtime_error("Error: could not create pipe for \""s + _name + "\""s);
+
+        for(size_t i = 0; i < _task_count; ++i)
+        {
+            if(!is_blocking(i))
+                _answer[i] = pool_bench::spin_work(i, _cpu_iterations);
+        }
+    }
+
+    void teardown() override
+    {
+        ::close(_pipe[0]);
+        ::close(_pipe[1]);
+        _pipe[0] = _pipe[1] = -1;
+    }
+
+    void
+    block(size_t i)
+    {
+        if(i % 2 == 0)
+        {
+            pollfd fd{_pipe[0], POLLIN, 0};
+            ::poll(&fd, 1, static_cast<int>(_block_time.count()));
+        }
+        else
+            std::this_thread::sleep_for(_block_time);
+        ++_blocked;
+    }
+
+    void
+    run(pool_bench::executor&& async) override
+    {
+        std::fill(_results.begin(), _results.end(), 0.0);
+        std::fill(_cpu_wait.begin(), _cpu_wait.end(), chrono::nanoseconds(0));
+        std::fill(_cpu_busy.begin(), _cpu_busy.end(), chrono::nanoseconds(0));
+        _blocked = 0;
+
+        auto tasks = std::vector<std::future<void>>();
+        tasks.reserve(_task_count);
+
+        auto span_start = chrono::steady_clock::now();
+        for(size_t i = 0; i < _task_count; ++i)
+        {
+            if(is_blocking(i))
+            {
+                tasks.emplace_back(async([this, i]{ block(i); }));
+                continue;
+            }
+
+            auto submitted = chrono::steady_clock::now();
+            tasks.emplace_back(async(
+                    [this, i, submitted]
+                    {
+                        auto start = chrono::steady_clock::now();
+                        _results[i] = pool_bench::spin_work(i, _cpu_iterations);
+                        auto stop = chrono::steady_clock::now();
+                        _cpu_wait[i] = start - submitted;
+                        _cpu_busy[i] = stop - start;
+                    }));
+        }
+
+        for(auto& i : tasks)
+            i.get();
+        _span = chrono::steady_clock::now() - span_start;
+    }
+
+    /*
+     * throughput: completed tasks per second over the whole run
+     * cpu wait:   mean and worst time a CPU task sat in the queue
+     * starved:    total queueing time of CPU tasks relative to their total
+     *             execution time
+     */
+    std::string report() override
+    {
+        using float_millisec = chrono::duration<double, std::milli>;
+
+        chrono::nanoseconds total_wait(0);
+        chrono::nanoseconds total_busy(0);
+        chrono::nanoseconds max_wait(0);
+        size_t cpu_tasks = 0;
+        for(size_t i = 0; i < _task_count; ++i)
+        {
+            if(is_blocking(i))
+                continue;
+            total_wait += _cpu_wait[i];
+            total_busy += _cpu_busy[i];
+            max_wait = std::max(max_wait, _cpu_wait[i]);
+            ++cpu_tasks;
+        }
+
+        double span = chrono::duration_cast<chrono::duration<double>>(_span).count();
+        double mean_wait = chrono::duration_cast<float_millisec>(total_wait).count()
+            / std::max<size_t>(cpu_tasks, 1);
+        double starved = static_cast<double>(total_wait.count())
+            / std::max<chrono::nanoseconds::rep>(total_busy.count(), 1);
+
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer),
+                 "    throughput %.1f tasks/s, cpu wait mean %.3fms max %.3fms, starved %.2fx",
+                 _task_count / span,
+                 mean_wait,
+                 chrono::duration_cast<float_millisec>(max_wait).count(),
+                 starved);
+        return buffer;
+    }
+};
+
+struct rarely_blocking_io : public blocking_io
+{
+    rarely_blocking_io()
+        : blocking_io(5)
+    {}
+};
+
+struct mostly_blocking_io : public blocking_io
+{
+    mostly_blocking_io()
+        : blocking_io(50)
+    {}
+};
+
+REGISTER_BENCHMARK(rarely_blocking_io)
+REGISTER_BENCHMARK(blocking_io)
+REGISTER_BENCHMARK(mostly_blocking_io)
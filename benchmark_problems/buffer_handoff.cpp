@@ -0,0 +1,184 @@
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018  Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <pool_bench.hpp>
+
+namespace chrono = std::chrono;
+
+namespace handoff
+{
+    using buffer = std::vector<float>;
+
+    inline void
+    fill(buffer& data, size_t seed)
+    {
+        for(size_t i = 0; i < data.size(); ++i)
+            data[i] = static_cast<float>((seed * 31 + i) % 1024) / 1024.0f;
+    }
+
+    inline void
+    transform(buffer& data)
+    {
+        for(auto& x : data)
+            x = x * 1.5f + 0.25f;
+    }
+
+    inline double
+    sum(buffer const& data)
+    {
+        double total = 0.0;
+        for(auto x : data)
+            total += x;
+        return total;
+    }
+}
+
+/*
+ * A two stage pipeline passing owned buffers between tasks, the way a
+ * data pipeline hands work on without copying it. Each buffer moves as a
+ * std::unique_ptr into a transform task, comes back through its typed
+ * future, and moves on into a reduction task that parks it again.
+ * The buffers must come back at the addresses they started at.
+ */
+struct buffer_handoff : public pool_bench::suite
+{
+    size_t _buffer_count;
+    size_t _buffer_size;
+
+    std::vector<std::unique_ptr<handoff::buffer>> _buffers;
+    std::vector<float const*> _addresses;
+    std::vector<double> _results;
+    std::vector<double> _answer;
+    chrono::nanoseconds _span;
+
+    buffer_handoff()
+        :_buffer_count(1024),
+         _buffer_size(16384),
+         _buffers(_buffer_count),
+         _addresses(_buffer_count),
+         _results(_buffer_count),
+         _answer(_buffer_count),
+         _span(0)
+    {}
+
+    size_t
+    problem_size() override
+    {
+        return 2 * _buffer_count;
+    }
+
+    char const*
+    name() override
+    {
+        return "buffer handoff";
+    }
+
+    bool check_result() override
+    {
+        for(size_t i = 0; i < _buffer_count; ++i)
+        {
+            if(!_buffers[i] || _buffers[i]->data() != _addresses[i])
+                return false;
+        }
+        return _results == _answer;
+    }
+
+    void prepare() override
+    {
+        auto scratch = handoff::buffer(_buffer_size);
+        for(size_t i = 0; i < _buffer_count; ++i)
+        {
+            handoff::fill(scratch, i);
+            handoff::transform(scratch);
+            _answer[i] = handoff::sum(scratch);
+            _buffers[i] = std::make_unique<handoff::buffer>(_buffer_size);
+        }
+    }
+
+    void teardown() override
+    {
+        for(auto& i : _buffers)
+            i.reset();
+    }
+
+    void reset() override
+    {
+        for(size_t i = 0; i < _buffer_count; ++i)
+        {
+            if(!_buffers[i])
+                _buffers[i] = std::make_unique<handoff::buffer>(_buffer_size);
+            handoff::fill(*_buffers[i], i);
+            _addresses[i] = _buffers[i]->data();
+        }
+        std::fill(_results.begin(), _results.end(), 0.0);
+    }
+
+    void
+    run(pool_bench::executor&& async) override
+    {
+        using owned = std::unique_ptr<handoff::buffer>;
+        auto transformed = std::vector<pool_bench::future<owned>>();
+        transformed.reserve(_buffer_count);
+        auto reduced = std::vector<std::future<void>>();
+        reduced.reserve(_buffer_count);
+
+        auto span_start = chrono::steady_clock::now();
+        for(size_t i = 0; i < _buffer_count; ++i)
+        {
+            transformed.emplace_back(async.submit(
+                    [data = std::move(_buffers[i])]() mutable
+                    {
+                        handoff::transform(*data);
+                        return std::move(data);
+                    }));
+        }
+
+        for(size_t i = 0; i < _buffer_count; ++i)
+        {
+            auto data = transformed[i].get();
+            reduced.emplace_back(async(
+                    [this, i, data = std::move(data)]() mutable
+                    {
+                        _results[i] = handoff::sum(*data);
+                        _buffers[i] = std::move(data);
+                    }));
+        }
+        pool_bench::join(reduced);
+        _span = chrono::steady_clock::now() - span_start;
+    }
+
+    std::string report() override
+    {
+        auto bytes = static_cast<double>(_buffer_count * _buffer_size * sizeof(float));
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer),
+                 "    %.2f GB/s through both stages, buffers moved, not copied",
+                 2 * bytes / chrono::duration<double>(_span).count() / 1e9);
+        return buffer;
+    }
+};
+
+REGISTER_BENCHMARK(buffer_handoff)
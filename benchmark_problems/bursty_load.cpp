@@ -0,0 +1,234 @@
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018  Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pool_bench.hpp>
+#include <pool_bench_memory.hpp>
+
+namespace chrono = std::chrono;
+
+/*
+ * A service that idles most of the time: floods of short tasks separated
+ * by idle periods longer than an elastic pool keeps its threads for.
+ * Latency runs from a task's submission until it starts; the first task
+ * of a flood shows what waking an idle pool costs. A sampling thread
+ * reads the pool's thread count and the resident set every millisecond.
+ * Pools that cannot tell their threads are counted from /proc, as the
+ * process's threads over those at the start of the run, the sampler left
+ * out; that takes in threads the pool keeps from before.
+ */
+struct bursty_load : public pool_bench::suite
+{
+    size_t _bursts;
+    size_t _burst_tasks;
+    size_t _iterations;
+    chrono::milliseconds _idle;
+    chrono::microseconds _sample_interval;
+
+    std::vector<double> _results;
+    std::vector<double> _answer;
+    std::vector<chrono::nanoseconds> _latency;
+
+    size_t _thread_samples;
+    bool _threads_over_start;
+    double _mean_threads;
+    size_t _max_threads;
+    size_t _resident_samples;
+    double _mean_resident_kb;
+    size_t _max_resident_kb;
+
+    bursty_load()
+        :_bursts(16),
+         _burst_tasks(1024),
+         _iterations(2000),
+         _idle(50),
+         _sample_interval(1000),
+         _results(_bursts * _burst_tasks),
+         _answer(_bursts * _burst_tasks),
+         _latency(_bursts * _burst_tasks),
+         _thread_samples(0),
+         _threads_over_start(false),
+         _mean_threads(0),
+         _max_threads(0),
+         _resident_samples(0),
+         _mean_resident_kb(0),
+         _max_resident_kb(0)
+    {}
+
+    size_t
+    problem_size() override
+    {
+        return _bursts * _burst_tasks;
+    }
+
+    char const*
+    name() override
+    {
+        return "bursty load";
+    }
+
+    bool check_result() override
+    {
+        return _results == _answer;
+    }
+
+    void prepare() override
+    {
+        for(size_t i = 0; i < _answer.size(); ++i)
+            _answer[i] = pool_bench::spin_work(i, _iterations);
+    }
+
+    void teardown() override {}
+
+    void reset() override
+    {
+        std::fill(_results.begin(), _results.end(), 0.0);
+        std::fill(_latency.begin(), _latency.end(), chrono::nanoseconds(0));
+    }
+
+    void
+    run(pool_bench::executor&& async) override
+    {
+        std::atomic<bool> sampling(true);
+        size_t thread_total = 0;
+        size_t resident_total = 0;
+        _thread_samples = 0;
+        _max_threads = 0;
+        _resident_samples = 0;
+        _max_resident_kb = 0;
+
+        auto pool = async.pool();
+        _threads_over_start = !pool || pool->threads() < 0;
+        /* The sampler is one more than the start */
+        auto start_threads = pool_bench::memory::thread_count() + 1;
+        auto pool_threads = [this, pool, start_threads]() -> long
+                            {
+                                if(!_threads_over_start)
+                                    return pool->threads();
+                                auto threads = pool_bench::memory::thread_count();
+                                return threads == 0 ? -1
+                                    : std::max(0L, static_cast<long>(threads)
+                                                   - static_cast<long>(start_threads));
+                            };
+
+        auto sampler = std::thread(
+            [&]
+            {
+                /* Without /proc thread_count() and resident_kb() read 0, and
+                 * those samples are left out */
+                while(sampling.load(std::memory_order_relaxed))
+                {
+                    auto threads = pool_threads();
+                    if(threads >= 0)
+                    {
+                        ++_thread_samples;
+                        thread_total += threads;
+                        _max_threads = std::max(_max_threads, static_cast<size_t>(threads));
+                    }
+                    auto resident = pool_bench::memory::resident_kb();
+                    if(resident != 0)
+                    {
+                        ++_resident_samples;
+                        resident_total += resident;
+                        _max_resident_kb = std::max(_max_resident_kb, resident);
+                    }
+                    std::this_thread::sleep_for(_sample_interval);
+                }
+            });
+
+        auto tasks = std::vector<std::future<void>>();
+        tasks.reserve(_burst_tasks);
+        for(size_t burst = 0; burst < _bursts; ++burst)
+        {
+            std::this_thread::sleep_for(_idle);
+            for(size_t i = 0; i < _burst_tasks; ++i)
+            {
+                auto index = burst * _burst_tasks + i;
+                auto submitted = chrono::steady_clock::now();
+                tasks.emplace_back(async(
+                        [this, index, submitted]
+                        {
+                            _latency[index] = chrono::steady_clock::now() - submitted;
+                            _results[index] = pool_bench::spin_work(index, _iterations);
+                        }));
+            }
+            pool_bench::join(tasks);
+            tasks.clear();
+        }
+
+        sampling = false;
+        sampler.join();
+        _mean_threads = _thread_samples
+            ? static_cast<double>(thread_total) / _thread_samples : 0.0;
+        _mean_resident_kb = _resident_samples
+            ? static_cast<double>(resident_total) / _resident_samples : 0.0;
+    }
+
+    /*
+     * latency:  submission to start over all tasks, and of each flood's first
+     * threads:  pool threads, mean and max over the samples, or process
+     *           threads over the start where the pool cannot tell
+     * resident: process resident set, mean and max over the samples
+     * either n/a where /proc/self/status cannot be read
+     */
+    std::string report() override
+    {
+        using float_microsec = chrono::duration<double, std::micro>;
+        auto sorted = _latency;
+        std::sort(sorted.begin(), sorted.end());
+        auto at = [&sorted](double quantile)
+                  {
+                      auto index = static_cast<size_t>(quantile * (sorted.size() - 1));
+                      return chrono::duration_cast<float_microsec>(sorted[index]).count();
+                  };
+
+        chrono::nanoseconds first_total(0);
+        for(size_t burst = 0; burst < _bursts; ++burst)
+            first_total += _latency[burst * _burst_tasks];
+
+        char threads[64] = "n/a";
+        if(_thread_samples != 0)
+            snprintf(threads, sizeof(threads), "%smean %.1f, max %zu",
+                     _threads_over_start ? "over start " : "", _mean_threads, _max_threads);
+        char resident[64] = "n/a";
+        if(_resident_samples != 0)
+            snprintf(resident, sizeof(resident), "mean %.1fMB, max %.1fMB",
+                     _mean_resident_kb / 1024.0, _max_resident_kb / 1024.0);
+
+        char buffer[384];
+        snprintf(buffer, sizeof(buffer),
+                 "    latency p50 %.1fus, p99 %.1fus, first of burst %.1fus\n"
+                 "    threads %s, resident %s",
+                 at(0.5),
+                 at(0.99),
+                 chrono::duration_cast<float_microsec>(first_total).count() / _bursts,
+                 threads,
+                 resident);
+        return buffer;
+    }
+};
+
+REGISTER_BENCHMARK(bursty_load)
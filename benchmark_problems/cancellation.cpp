@@ -0,0 +1,323 @@
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018  Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pool_bench.hpp>
+
+namespace chrono = std::chrono;
+
+/*
+ * Short tasks of which a fixed share throws after doing its work, so the
+ * exception travels through the pool's packaged_task into the future.
+ * Which tasks throw is spread evenly by a multiplicative hash of the index.
+ */
+struct throwing_tasks : public pool_bench::suite
+{
+    size_t _task_count;
+    size_t _iterations;
+    unsigned _percent;
+    std::string _name;
+
+    std::vector<double> _results;
+    std::vector<double> _answer;
+    size_t _expected;
+    size_t _caught;
+    chrono::nanoseconds _span;
+
+    throwing_tasks(unsigned percent = 10)
+        :_task_count(16384),
+         _iterations(500),
+         _percent(percent),
+         _name("throwing tasks (" + std::to_string(percent) + "%)"),
+         _results(_task_count),
+         _answer(_task_count),
+         _expected(0),
+         _caught(0),
+         _span(0)
+    {}
+
+    inline bool
+    throws(size_t index) const
+    {
+        return (index * 2654435761u) % 100 < _percent;
+    }
+
+    size_t
+    problem_size() override
+    {
+        return _task_count;
+    }
+
+    char const*
+    name() override
+    {
+        return _name.c_str();
+    }
+
+    bool check_result() override
+    {
+        return _caught == _expected && _results == _answer;
+    }
+
+    void prepare() override
+    {
+        _expected = 0;
+        for(size_t i = 0; i < _task_count; ++i)
+        {
+            _answer[i] = pool_bench::spin_work(i, _iterations);
+            _expected += throws(i);
+        }
+    }
+
+    void teardown() override {}
+
+    void reset() override
+    {
+        std::fill(_results.begin(), _results.end(), 0.0);
+        _caught = 0;
+    }
+
+    void
+    run(pool_bench::executor&& async) override
+    {
+        auto tasks = std::vector<std::future<void>>();
+        tasks.reserve(_task_count);
+
+        auto span_start = chrono::steady_clock::now();
+        for(size_t i = 0; i < _task_count; ++i)
+        {
+            tasks.emplace_back(async(
+                    [this, i]
+                    {
+                        _results[i] = pool_bench::spin_work(i, _iterations);
+                        if(throws(i))
+                            throw std::runtime_error("task failed");
+                    }));
+        }
+
+        {
+            pool_bench::barrier scope;
+            for(auto& i : tasks)
+            {
+                try
+                {
+                    i.get();
+                }
+                catch(std::runtime_error const&)
+                {
+                    ++_caught;
+                }
+            }
+        }
+        _span = chrono::steady_clock::now() - span_start;
+    }
+
+    std::string report() override
+    {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer),
+                 "    %zu of %zu tasks threw, %.0f tasks/s",
+                 _caught,
+                 _task_count,
+                 _task_count / chrono::duration<double>(_span).count());
+        return buffer;
+    }
+};
+
+struct mostly_throwing_tasks : public throwing_tasks
+{
+    mostly_throwing_tasks()
+        : throwing_tasks(50)
+    {}
+};
+
+REGISTER_BENCHMARK(throwing_tasks)
+REGISTER_BENCHMARK(mostly_throwing_tasks)
+
+/*
+ * A large fan-out abandoned part way, as when the client behind it
+ * disconnects. Once an eighth of the tasks have finished, the shared
+ * cancellation token is set and the runner is asked to drop what is
+ * still queued; tasks that start after that return at once. Time to
+ * quiesce runs from the cancellation until every future is ready,
+ * dropped ones reporting a broken promise.
+ */
+struct cancelled_fan_out : public pool_bench::suite
+{
+    size_t _task_count;
+    size_t _iterations;
+    size_t _cancel_after;
+
+    std::vector<double> _results;
+    std::vector<double> _answer;
+    std::vector<char> _finished;
+    std::atomic<size_t> _completed;
+    std::atomic<size_t> _skipped;
+    size_t _completed_at_cancel;
+    size_t _dropped;
+    size_t _broken;
+    chrono::nanoseconds _before_cancel;
+    chrono::nanoseconds _quiesce;
+
+    cancelled_fan_out()
+        :_task_count(16384),
+         _iterations(4000),
+         _cancel_after(_task_count / 8),
+         _results(_task_count),
+         _answer(_task_count),
+         _finished(_task_count),
+         _completed(0),
+         _skipped(0),
+         _completed_at_cancel(0),
+         _dropped(0),
+         _broken(0),
+         _before_cancel(0),
+         _quiesce(0)
+    {}
+
+    size_t
+    problem_size() override
+    {
+        return _task_count;
+    }
+
+    char const*
+    name() override
+    {
+        return "cancelled fan out";
+    }
+
+    /* Every task finished, skipped or dropped, and the finished ones right */
+    bool check_result() override
+    {
+        if(_completed + _skipped + _broken != _task_count || _broken != _dropped)
+            return false;
+        for(size_t i = 0; i < _task_count; ++i)
+        {
+            if(_finished[i] && _results[i] != _answer[i])
+                return false;
+        }
+        return true;
+    }
+
+    void prepare() override
+    {
+        for(size_t i = 0; i < _task_count; ++i)
+            _answer[i] = pool_bench::spin_work(i, _iterations);
+    }
+
+    void teardown() override {}
+
+    void reset() override
+    {
+        std::fill(_results.begin(), _results.end(), 0.0);
+        std::fill(_finished.begin(), _finished.end(), 0);
+        _completed = 0;
+        _skipped = 0;
+        _dropped = 0;
+        _broken = 0;
+    }
+
+    /* Draining the runner's queues would take other suites' work with it */
+    bool shares_pool() override
+    {
+        return false;
+    }
+
+    void
+    run(pool_bench::executor&& async) override
+    {
+        auto tasks = std::vector<std::future<void>>();
+        tasks.reserve(_task_count);
+        auto token = pool_bench::cancellation_token();
+
+        auto span_start = chrono::steady_clock::now();
+        for(size_t i = 0; i < _task_count; ++i)
+        {
+            tasks.emplace_back(async(
+                    [this, i, token]
+                    {
+                        if(token.cancelled())
+                        {
+                            _skipped.fetch_add(1, std::memory_order_relaxed);
+                            return;
+                        }
+                        _results[i] = pool_bench::spin_work(i, _iterations);
+                        _finished[i] = 1;
+                        _completed.fetch_add(1, std::memory_order_relaxed);
+                    }));
+        }
+
+        while(_completed.load(std::memory_order_relaxed) < _cancel_after)
+            std::this_thread::yield();
+
+        auto cancel_start = chrono::steady_clock::now();
+        _completed_at_cancel = _completed.load(std::memory_order_relaxed);
+        token.cancel();
+        _dropped = async.pool() ? async.pool()->cancel_pending() : 0;
+
+        {
+            pool_bench::barrier scope;
+            for(auto& i : tasks)
+            {
+                try
+                {
+                    i.get();
+                }
+                catch(std::future_error const&)
+                {
+                    ++_broken;
+                }
+            }
+        }
+        auto cancel_stop = chrono::steady_clock::now();
+        _before_cancel = cancel_start - span_start;
+        _quiesce = cancel_stop - cancel_start;
+    }
+
+    /*
+     * finished:  tasks that ran to completion, before or after cancelling
+     * skipped:   tasks that started after cancelling and saw the token
+     * dropped:   tasks the runner removed from its queues unstarted
+     * quiesce:   from cancelling until every future was ready
+     * tasks/s:   completions before cancelling over the time until then
+     */
+    std::string report() override
+    {
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer),
+                 "    finished %zu, skipped %zu, dropped %zu, quiesce %.3fms, %.0f tasks/s before cancelling",
+                 _completed.load(),
+                 _skipped.load(),
+                 _dropped,
+                 chrono::duration<double, std::milli>(_quiesce).count(),
+                 _completed_at_cancel / chrono::duration<double>(_before_cancel).count());
+        return buffer;
+    }
+};
+
+REGISTER_BENCHMARK(cancelled_fan_out)
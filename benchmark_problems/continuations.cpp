@@ -0,0 +1,212 @@
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018  Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <pool_bench.hpp>
+
+namespace chrono = std::chrono;
+
+namespace chained
+{
+    /* A few hundred nanoseconds of integer mixing, so links are mostly overhead */
+    inline uint64_t
+    step(uint64_t x, uint64_t link)
+    {
+        for(size_t i = 0; i < 64; ++i)
+        {
+            x ^= x >> 31;
+            x = x * 0x9E3779B97F4A7C15ull + link;
+        }
+        return x;
+    }
+
+    inline uint64_t
+    leaf(uint64_t index)
+    {
+        return step(index + 1, index);
+    }
+}
+
+/*
+ * Task graphs built from continuations instead of blocking waits.
+ * chains: independent chains of dependent tasks, each link started by
+ *         the thread that finished the one before it
+ * trees:  binary fan-in trees, each node joining its two children with
+ *         when_all and adding their results
+ * The chain tails and tree roots must match the sequential answers.
+ */
+struct continuations : public pool_bench::suite
+{
+    size_t _chain_count;
+    size_t _chain_length;
+    size_t _tree_count;
+    size_t _tree_leaves;
+
+    std::vector<uint64_t> _tails;
+    std::vector<uint64_t> _tails_answer;
+    std::vector<uint64_t> _roots;
+    std::vector<uint64_t> _roots_answer;
+    chrono::nanoseconds _chain_span;
+    chrono::nanoseconds _tree_span;
+
+    continuations()
+        :_chain_count(64),
+         _chain_length(1024),
+         _tree_count(8),
+         _tree_leaves(1024),
+         _tails(_chain_count),
+         _tails_answer(_chain_count),
+         _roots(_tree_count),
+         _roots_answer(_tree_count),
+         _chain_span(0),
+         _tree_span(0)
+    {}
+
+    size_t
+    problem_size() override
+    {
+        return _chain_count * _chain_length + _tree_count * (2 * _tree_leaves - 1);
+    }
+
+    char const*
+    name() override
+    {
+        return "continuations";
+    }
+
+    bool check_result() override
+    {
+        return _tails == _tails_answer && _roots == _roots_answer;
+    }
+
+    void prepare() override
+    {
+        for(size_t c = 0; c < _chain_count; ++c)
+        {
+            uint64_t x = c;
+            for(size_t link = 0; link < _chain_length; ++link)
+                x = chained::step(x, link);
+            _tails_answer[c] = x;
+        }
+
+        for(size_t t = 0; t < _tree_count; ++t)
+        {
+            uint64_t sum = 0;
+            for(size_t i = 0; i < _tree_leaves; ++i)
+                sum += chained::leaf(t * _tree_leaves + i);
+            _roots_answer[t] = sum;
+        }
+    }
+
+    void teardown() override {}
+
+    void reset() override
+    {
+        std::fill(_tails.begin(), _tails.end(), 0);
+        std::fill(_roots.begin(), _roots.end(), 0);
+    }
+
+    void
+    run(pool_bench::executor&& async) override
+    {
+        {
+            pool_bench::phase scope("chains");
+            auto span_start = chrono::steady_clock::now();
+
+            auto tails = std::vector<pool_bench::continuable<uint64_t>>();
+            tails.reserve(_chain_count);
+            for(size_t c = 0; c < _chain_count; ++c)
+            {
+                auto link = async.spawn([c]{ return chained::step(c, 0); });
+                for(size_t i = 1; i < _chain_length; ++i)
+                    link = async.then(link, [i](uint64_t x){ return chained::step(x, i); });
+                tails.emplace_back(std::move(link));
+            }
+
+            {
+                pool_bench::barrier wait;
+                for(size_t c = 0; c < _chain_count; ++c)
+                    _tails[c] = tails[c].get();
+            }
+            _chain_span = chrono::steady_clock::now() - span_start;
+        }
+
+        {
+            pool_bench::phase scope("trees");
+            auto span_start = chrono::steady_clock::now();
+
+            using node = pool_bench::continuable<uint64_t>;
+            auto roots = std::vector<node>();
+            roots.reserve(_tree_count);
+            for(size_t t = 0; t < _tree_count; ++t)
+            {
+                auto level = std::vector<node>();
+                level.reserve(_tree_leaves);
+                for(size_t i = 0; i < _tree_leaves; ++i)
+                {
+                    auto index = t * _tree_leaves + i;
+                    level.emplace_back(async.spawn([index]{ return chained::leaf(index); }));
+                }
+
+                while(level.size() > 1)
+                {
+                    auto next = std::vector<node>();
+                    next.reserve(level.size() / 2);
+                    for(size_t i = 0; i + 1 < level.size(); i += 2)
+                    {
+                        auto a = level[i];
+                        auto b = level[i + 1];
+                        next.emplace_back(async.then(pool_bench::when_all(std::vector<node>{a, b}),
+                                                     [a, b]{ return a.get() + b.get(); }));
+                    }
+                    level.swap(next);
+                }
+                roots.emplace_back(std::move(level.front()));
+            }
+
+            {
+                pool_bench::barrier wait;
+                for(size_t t = 0; t < _tree_count; ++t)
+                    _roots[t] = roots[t].get();
+            }
+            _tree_span = chrono::steady_clock::now() - span_start;
+        }
+    }
+
+    /* Each phase's span over its dependent tasks, including building the graph */
+    std::string report() override
+    {
+        using float_microsec = chrono::duration<double, std::micro>;
+        auto links = static_cast<double>(_chain_count * _chain_length);
+        auto nodes = static_cast<double>(_tree_count * (_tree_leaves - 1));
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer),
+                 "    %.3fus per chained link, %.3fus per fan-in node",
+                 chrono::duration_cast<float_microsec>(_chain_span).count() / links,
+                 chrono::duration_cast<float_microsec>(_tree_span).count() / nodes);
+        return buffer;
+    }
+};
+
+REGISTER_BENCHMARK(continuations)
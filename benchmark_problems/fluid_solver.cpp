@@ -28,10 +28,21 @@
 */
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
 #include <vector>
 #include <cmath>
 
 #include <pool_bench.hpp>
+#include <pool_bench_reference.hpp>
+#include "simd.hpp"
+
+using namespace std::string_literals;
 
 /* Length of vector (x, y) */
 double length(double x, double y) {
@@ -113,6 +124,12 @@ struct FluidQuantity {
         swap(_src, _dst);
     }
     
+    /* Back to the state after construction */
+    void reset() {
+        std::fill(_src.begin(), _src.end(), 0.0);
+        std::fill(_dst.begin(), _dst.end(), 0.0);
+    }
+    
     const std::vector<double>& src() const {
         return _src;
     }
@@ -161,11 +178,14 @@ struct FluidQuantity {
         return cerp(q0, q1, q2, q3, y);
     }
     
-    /* Advect grid in velocity field u, v with given timestep */
-    void advect(double timestep, const FluidQuantity &u, const FluidQuantity &v) {
-        for (int iy = 0, idx = 0; iy < _h; iy++) {
+    /* Advect the cells [x0, x1) x [y0, y1) of the grid in velocity field
+     * u, v with given timestep, writing the result into dst
+     */
+    void advect(double timestep, const FluidQuantity &u, const FluidQuantity &v,
+                int x0, int y0, int x1, int y1, std::vector<double> &dst) const {
+        for (int iy = y0; iy < y1; iy++) {
             
-            for (int ix = 0; ix < _w; ix++, idx++) {
+            for (int ix = x0, idx = x0 + iy*_w; ix < x1; ix++, idx++) {
                 double x = ix + _ox;
                 double y = iy + _oy;
                 
@@ -173,11 +193,21 @@ struct FluidQuantity {
                 rungeKutta3(x, y, timestep, u, v);
                 
                 /* Second component: Interpolate from grid */
-                _dst[idx] = cerp(x, y);
+                dst[idx] = cerp(x, y);
             }
         }
     }
     
+    void advect(double timestep, const FluidQuantity &u, const FluidQuantity &v,
+                int x0, int y0, int x1, int y1) {
+        advect(timestep, u, v, x0, y0, x1, y1, _dst);
+    }
+    
+    /* Advect grid in velocity field u, v with given timestep */
+    void advect(double timestep, const FluidQuantity &u, const FluidQuantity &v) {
+        advect(timestep, u, v, 0, 0, _w, _h);
+    }
+    
     /* Set fluid quantity inside the given rect to the specified value, but use
      * a smooth falloff to avoid oscillations
      */
@@ -227,53 +257,86 @@ struct FluidSolver {
          _p(w * h, 0)
     {}
     
-    void buildRhs() {
+    /* Right hand side of the pressure equation for rows [y0, y1) */
+    void buildRhs(int y0, int y1) {
         double scale = 1.0/_hx;
         
-        for (int y = 0, idx = 0; y < _h; y++) {
-            for (int x = 0; x < _w; x++, idx++) {
+        for (int y = y0; y < y1; y++) {
+            for (int x = 0, idx = y*_w; x < _w; x++, idx++) {
                 _r[idx] = -scale*(_u.at(x + 1, y) - _u.at(x, y) +
                                   _v.at(x, y + 1) - _v.at(x, y));
             }
         }
     }
     
-    void project(int limit, double timestep) {
-        double scale = timestep/(_density*_hx*_hx);
+    void buildRhs() {
+        buildRhs(0, _h);
+    }
+    
+    void reset() {
+        _d.reset();
+        _u.reset();
+        _v.reset();
+        std::fill(_r.begin(), _r.end(), 0.0);
+        std::fill(_p.begin(), _p.end(), 0.0);
+    }
+    
+    /* One Gauss-Seidel half sweep over the cells of rows [y0, y1) with
+     * (x + y) % 2 == color. Cells of one color only read cells of the other,
+     * so any set of row ranges can be relaxed concurrently and in any order.
+     * Returns the largest pressure change.
+     */
+    double relax(int color, int y0, int y1, double scale) {
+        double maxDelta = 0.0;
         
-        double maxDelta;
-        for (int iter = 0; iter < limit; iter++) {
-            maxDelta = 0.0;
-            for (int y = 0, idx = 0; y < _h; y++) {
-                for (int x = 0; x < _w; x++, idx++) {
-                    int idx = x + y*_w;
-                    
-                    double diag = 0.0, offDiag = 0.0;
-                    
-                    if (x > 0) {
-                        diag    += scale;
-                        offDiag -= scale*_p[idx - 1];
-                    }
-                    if (y > 0) {
-                        diag    += scale;
-                        offDiag -= scale*_p[idx - _w];
-                    }
-                    if (x < _w - 1) {
-                        diag    += scale;
-                        offDiag -= scale*_p[idx + 1];
-                    }
-                    if (y < _h - 1) {
-                        diag    += scale;
-                        offDiag -= scale*_p[idx + _w];
-                    }
-
-                    double newP = (_r[idx] - offDiag)/diag;
-                    
-                    maxDelta = std::max(maxDelta, fabs(_p[idx] - newP));
-                    
-                    _p[idx] = newP;
+        for (int y = y0; y < y1; y++) {
+            for (int x = (y + color) & 1; x < _w; x += 2) {
+                int idx = x + y*_w;
+                
+                double diag = 0.0, offDiag = 0.0;
+                
+                if (x > 0) {
+                    diag    += scale;
+                    offDiag -= scale*_p[idx - 1];
+                }
+                if (y > 0) {
+                    diag    += scale;
+                    offDiag -= scale*_p[idx - _w];
+                }
+                if (x < _w - 1) {
+                    diag    += scale;
+                    offDiag -= scale*_p[idx + 1];
                 }
+                if (y < _h - 1) {
+                    diag    += scale;
+                    offDiag -= scale*_p[idx + _w];
+                }
+
+                double newP = (_r[idx] - offDiag)/diag;
+                
+                maxDelta = std::max(maxDelta, fabs(_p[idx] - newP));
+                
+                _p[idx] = newP;
             }
+        }
+        return maxDelta;
+    }
+    
+    double projectScale(double timestep) const {
+        return timestep/(_density*_hx*_hx);
+    }
+    
+    /* Red-black Gauss-Seidel, which replaced the original lexicographic
+     * sweep and converges differently from it. The serial reference uses
+     * this ordering too, so the benchmark can relax each color in parallel
+     * and still match it exactly.
+     */
+    void project(int limit, double timestep) {
+        double scale = projectScale(timestep);
+        
+        for (int iter = 0; iter < limit; iter++) {
+            double maxDelta = relax(0, 0, _h, scale);
+            maxDelta = std::max(maxDelta, relax(1, 0, _h, scale));
 
             if (maxDelta < 1e-5) {
                 return;
@@ -281,22 +344,39 @@ struct FluidSolver {
         }
     }
     
-    void applyPressure(double timestep) {
+    /* Pressure update of the velocity rows [y0, y1), written so that each
+     * row only depends on pressure values and is owned by a single caller.
+     * The last row range also owns the extra row of _v.
+     */
+    void applyPressure(int y0, int y1, double timestep) {
         double scale = timestep/(_density*_hx);
         
-        for (int y = 0, idx = 0; y < _h; y++) {
-            for (int x = 0; x < _w; x++, idx++) {
-                _u.at(x,     y    ) -= scale*_p[idx];
-                _u.at(x + 1, y    ) += scale*_p[idx];
-                _v.at(x,     y    ) -= scale*_p[idx];
-                _v.at(x,     y + 1) += scale*_p[idx];
+        for (int y = y0; y < y1; y++) {
+            for (int x = 1; x < _w; x++) {
+                _u.at(x, y) += scale*_p[x - 1 + y*_w];
+                _u.at(x, y) -= scale*_p[x + y*_w];
+            }
+            _u.at(0, y) = _u.at(_w, y) = 0.0;
+            
+            if (y == 0) {
+                for (int x = 0; x < _w; x++)
+                    _v.at(x, 0) = 0.0;
+                continue;
+            }
+            for (int x = 0; x < _w; x++) {
+                _v.at(x, y) += scale*_p[x + (y - 1)*_w];
+                _v.at(x, y) -= scale*_p[x + y*_w];
             }
         }
         
-        for (int y = 0; y < _h; y++)
-            _u.at(0, y) = _u.at(_w, y) = 0.0;
-        for (int x = 0; x < _w; x++)
-            _v.at(x, 0) = _v.at(x, _h) = 0.0;
+        if (y1 == _h) {
+            for (int x = 0; x < _w; x++)
+                _v.at(x, _h) = 0.0;
+        }
+    }
+    
+    void applyPressure(double timestep) {
+        applyPressure(0, _h, timestep);
     }
     
     void addInflow(double x, double y,
@@ -306,47 +386,363 @@ struct FluidSolver {
         _u.addInflow(x, y, x + w, y + h, u);
         _v.addInflow(x, y, x + w, y + h, v);
     }
+};
 
-    std::pair<size_t, size_t>
-    dimensions() const {
-        return {_w, _h};
+bool is_equal(FluidQuantity const& a,
+              double const* b,
+              double epsilon)
+{
+    auto& x = a.src();
+    for (size_t i = 0; i < x.size(); i++) {
+        if(std::abs(x[i] - b[i]) > epsilon)
+            return false;
+    }
+    return true;
+}
+
+/* Single precision FluidQuantity, source and destination grid, that the
+ * vectorized suite keeps across steps. It is narrowed from the double
+ * quantity on reset and only widened back for the reference check.
+ */
+struct FluidQuantityF {
+    std::vector<float> _src;
+    std::vector<float> _dst;
+    
+    int _w;
+    int _h;
+    float _ox;
+    float _oy;
+    
+    FluidQuantityF()
+        :_w(0), _h(0), _ox(0), _oy(0)
+    {}
+    
+    /* Narrow the double quantity's source grid */
+    void assign(const FluidQuantity &q) {
+        _src.assign(q._src.begin(), q._src.end());
+        _dst.assign(q._src.size(), 0.0f);
+        _w = q._w;
+        _h = q._h;
+        _ox = (float)q._ox;
+        _oy = (float)q._oy;
+    }
+    
+    /* Widen the source grid into the double quantity's */
+    void widen(FluidQuantity &q) const {
+        std::copy(_src.begin(), _src.end(), q._src.begin());
+    }
+    
+    void flip() {
+        swap(_src, _dst);
+    }
+    
+    float at(int x, int y) const {
+        return _src[x + y*_w];
+    }
+    
+    float& at(int x, int y) {
+        return _src[x + y*_w];
+    }
+    
+    float lerp(float a, float b, float x) const {
+        return a*(1.0f - x) + b*x;
+    }
+    
+    float cerp(float a, float b, float c, float d, float x) const {
+        float xsq = x*x;
+        float xcu = xsq*x;
+        
+        float minV = std::min(a, std::min(b, std::min(c, d)));
+        float maxV = std::max(a, std::max(b, std::max(c, d)));
+
+        float t =
+            a*(0.0f - 0.5f*x + 1.0f*xsq - 0.5f*xcu) +
+            b*(1.0f + 0.0f*x - 2.5f*xsq + 1.5f*xcu) +
+            c*(0.0f + 0.5f*x + 2.0f*xsq - 1.5f*xcu) +
+            d*(0.0f + 0.0f*x - 0.5f*xsq + 0.5f*xcu);
+        
+        return std::min(std::max(t, minV), maxV);
+    }
+    
+    float lerp(float x, float y) const {
+        x = std::min(std::max(x - _ox, 0.0f), _w - 1.001f);
+        y = std::min(std::max(y - _oy, 0.0f), _h - 1.001f);
+        int ix = (int)x;
+        int iy = (int)y;
+        x -= ix;
+        y -= iy;
+        
+        float x00 = at(ix + 0, iy + 0), x10 = at(ix + 1, iy + 0);
+        float x01 = at(ix + 0, iy + 1), x11 = at(ix + 1, iy + 1);
+        
+        return lerp(lerp(x00, x10, x), lerp(x01, x11, x), y);
+    }
+    
+    float cerp(float x, float y) const {
+        x = std::min(std::max(x - _ox, 0.0f), _w - 1.001f);
+        y = std::min(std::max(y - _oy, 0.0f), _h - 1.001f);
+        int ix = (int)x;
+        int iy = (int)y;
+        x -= ix;
+        y -= iy;
+        
+        int x0 = std::max(ix - 1, 0), x1 = ix, x2 = ix + 1, x3 = std::min(ix + 2, _w - 1);
+        int y0 = std::max(iy - 1, 0), y1 = iy, y2 = iy + 1, y3 = std::min(iy + 2, _h - 1);
+        
+        float q0 = cerp(at(x0, y0), at(x1, y0), at(x2, y0), at(x3, y0), x);
+        float q1 = cerp(at(x0, y1), at(x1, y1), at(x2, y1), at(x3, y1), x);
+        float q2 = cerp(at(x0, y2), at(x1, y2), at(x2, y2), at(x3, y2), x);
+        float q3 = cerp(at(x0, y3), at(x1, y3), at(x2, y3), at(x3, y3), x);
+        
+        return cerp(q0, q1, q2, q3, y);
     }
+    
+    /* Same integration as FluidQuantity::rungeKutta3 */
+    void rungeKutta3(float &x, float &y, float timestep, float hx,
+                     const FluidQuantityF &u, const FluidQuantityF &v) const {
+        float firstU = u.lerp(x, y)/hx;
+        float firstV = v.lerp(x, y)/hx;
+
+        float midX = x - 0.5f*timestep*firstU;
+        float midY = y - 0.5f*timestep*firstV;
 
-    double operator[](size_t i) const {
-        return _d.src()[i];
+        float midU = u.lerp(midX, midY)/hx;
+        float midV = v.lerp(midX, midY)/hx;
+
+        float lastX = x - 0.75f*timestep*midU;
+        float lastY = y - 0.75f*timestep*midV;
+
+        float lastU = u.lerp(lastX, lastY);
+        float lastV = v.lerp(lastX, lastY);
+        
+        x -= timestep*((2.0f/9.0f)*firstU + (3.0f/9.0f)*midU + (4.0f/9.0f)*lastU);
+        y -= timestep*((2.0f/9.0f)*firstV + (3.0f/9.0f)*midV + (4.0f/9.0f)*lastV);
+    }
+    
+    /* Advect the cells [x0, x1) of row iy into dst, one cell at a time */
+    void advect(float timestep, float hx,
+                const FluidQuantityF &u, const FluidQuantityF &v,
+                int x0, int x1, int iy, float *dst) const {
+        for (int ix = x0; ix < x1; ix++) {
+            float x = ix + _ox;
+            float y = iy + _oy;
+            rungeKutta3(x, y, timestep, hx, u, v);
+            dst[ix + iy*_w] = cerp(x, y);
+        }
     }
 };
 
-bool is_equal(FluidSolver const& a,
-              FluidSolver const& b,
-              double epsilon)
+#if POOL_BENCH_X86_SIMD
+/* FluidQuantityF's interpolation and integration for 8 cells per call,
+ * gathering the interpolation stencils from the single precision grid.
+ */
+namespace advect_avx2
 {
-    auto shape = a.dimensions();
-    for (size_t i = 0; i < shape.first * shape.second; i++) {
-        if(std::abs(a[i] - b[i]) > epsilon)
-            return false;
+    struct grid
+    {
+        float const* src;
+        __m256 ox, oy, xmax, ymax;
+        __m256i w, wmax, hmax;
+
+        POOL_BENCH_TARGET("avx2,fma")
+        grid(const FluidQuantityF &q)
+            :src(q._src.data()),
+             ox(_mm256_set1_ps(q._ox)),
+             oy(_mm256_set1_ps(q._oy)),
+             xmax(_mm256_set1_ps(q._w - 1.001f)),
+             ymax(_mm256_set1_ps(q._h - 1.001f)),
+             w(_mm256_set1_epi32(q._w)),
+             wmax(_mm256_set1_epi32(q._w - 1)),
+             hmax(_mm256_set1_epi32(q._h - 1))
+        {}
+    };
+
+    POOL_BENCH_TARGET("avx2,fma")
+    inline __m256
+    lerp(__m256 a, __m256 b, __m256 x)
+    {
+        return _mm256_add_ps(_mm256_mul_ps(a, _mm256_sub_ps(_mm256_set1_ps(1.0f), x)),
+                             _mm256_mul_ps(b, x));
+    }
+
+    POOL_BENCH_TARGET("avx2,fma")
+    inline __m256
+    gather(grid const& g, __m256i idx)
+    {
+        return _mm256_i32gather_ps(g.src, idx, 4);
+    }
+
+    /* Clamps (x, y) into the grid and splits it into cell and fraction */
+    POOL_BENCH_TARGET("avx2,fma")
+    inline void
+    locate(grid const& g, __m256& x, __m256& y, __m256i& ix, __m256i& iy)
+    {
+        __m256 zero = _mm256_setzero_ps();
+        x = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(x, g.ox), zero), g.xmax);
+        y = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(y, g.oy), zero), g.ymax);
+        ix = _mm256_cvttps_epi32(x);
+        iy = _mm256_cvttps_epi32(y);
+        x = _mm256_sub_ps(x, _mm256_cvtepi32_ps(ix));
+        y = _mm256_sub_ps(y, _mm256_cvtepi32_ps(iy));
+    }
+
+    POOL_BENCH_TARGET("avx2,fma")
+    inline __m256
+    lerp(grid const& g, __m256 x, __m256 y)
+    {
+        __m256i ix, iy;
+        locate(g, x, y, ix, iy);
+
+        __m256i idx = _mm256_add_epi32(ix, _mm256_mullo_epi32(iy, g.w));
+        __m256i one = _mm256_set1_epi32(1);
+        __m256 x00 = gather(g, idx);
+        __m256 x10 = gather(g, _mm256_add_epi32(idx, one));
+        __m256 x01 = gather(g, _mm256_add_epi32(idx, g.w));
+        __m256 x11 = gather(g, _mm256_add_epi32(_mm256_add_epi32(idx, g.w), one));
+
+        return lerp(lerp(x00, x10, x), lerp(x01, x11, x), y);
+    }
+
+    POOL_BENCH_TARGET("avx2,fma")
+    inline __m256
+    cerp(__m256 a, __m256 b, __m256 c, __m256 d, __m256 x)
+    {
+        __m256 xsq = _mm256_mul_ps(x, x);
+        __m256 xcu = _mm256_mul_ps(xsq, x);
+
+        __m256 minV = _mm256_min_ps(a, _mm256_min_ps(b, _mm256_min_ps(c, d)));
+        __m256 maxV = _mm256_max_ps(a, _mm256_max_ps(b, _mm256_max_ps(c, d)));
+
+        /* The weights of FluidQuantity::cerp, as polynomials in x */
+        __m256 half = _mm256_set1_ps(0.5f);
+        __m256 nhalf = _mm256_set1_ps(-0.5f);
+        __m256 wa = _mm256_fmadd_ps(nhalf, xcu, _mm256_fmadd_ps(nhalf, x, xsq));
+        __m256 wb = _mm256_fmadd_ps(_mm256_set1_ps(1.5f), xcu,
+                                    _mm256_fmadd_ps(_mm256_set1_ps(-2.5f), xsq,
+                                                    _mm256_set1_ps(1.0f)));
+        __m256 wc = _mm256_fmadd_ps(_mm256_set1_ps(-1.5f), xcu,
+                                    _mm256_fmadd_ps(_mm256_set1_ps(2.0f), xsq,
+                                                    _mm256_mul_ps(half, x)));
+        __m256 wd = _mm256_fmadd_ps(half, xcu, _mm256_mul_ps(nhalf, xsq));
+
+        __m256 t = _mm256_fmadd_ps(a, wa, _mm256_fmadd_ps(b, wb, _mm256_fmadd_ps(c, wc, _mm256_mul_ps(d, wd))));
+        return _mm256_min_ps(_mm256_max_ps(t, minV), maxV);
+    }
+
+    POOL_BENCH_TARGET("avx2,fma")
+    inline __m256
+    cerp(grid const& g, __m256 x, __m256 y)
+    {
+        __m256i ix, iy;
+        locate(g, x, y, ix, iy);
+
+        __m256i zero = _mm256_setzero_si256();
+        __m256i one = _mm256_set1_epi32(1);
+        __m256i two = _mm256_set1_epi32(2);
+        __m256i xs[4] = {_mm256_max_epi32(_mm256_sub_epi32(ix, one), zero),
+                         ix,
+                         _mm256_add_epi32(ix, one),
+                         _mm256_min_epi32(_mm256_add_epi32(ix, two), g.wmax)};
+        __m256i ys[4] = {_mm256_max_epi32(_mm256_sub_epi32(iy, one), zero),
+                         iy,
+                         _mm256_add_epi32(iy, one),
+                         _mm256_min_epi32(_mm256_add_epi32(iy, two), g.hmax)};
+
+        __m256 q[4];
+        for(int r = 0; r < 4; ++r)
+        {
+            __m256i row = _mm256_mullo_epi32(ys[r], g.w);
+            q[r] = cerp(gather(g, _mm256_add_epi32(row, xs[0])),
+                        gather(g, _mm256_add_epi32(row, xs[1])),
+                        gather(g, _mm256_add_epi32(row, xs[2])),
+                        gather(g, _mm256_add_epi32(row, xs[3])),
+                        x);
+        }
+        return cerp(q[0], q[1], q[2], q[3], y);
+    }
+
+    /* FluidQuantityF::advect over a row, 8 cells at a time, scalar tail */
+    POOL_BENCH_TARGET("avx2,fma")
+    inline void
+    advect(const FluidQuantityF &q, float timestep, float hx,
+           const FluidQuantityF &u, const FluidQuantityF &v,
+           int x0, int x1, int iy, float *dst)
+    {
+        grid self(q), gu(u), gv(v);
+        __m256 dt = _mm256_set1_ps(timestep);
+        __m256 inv_hx = _mm256_set1_ps(1.0f/hx);
+        __m256 lane = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256 y0 = _mm256_set1_ps(iy + q._oy);
+
+        int ix = x0;
+        for(; ix + 8 <= x1; ix += 8)
+        {
+            __m256 x = _mm256_add_ps(_mm256_set1_ps(ix + q._ox), lane);
+            __m256 y = y0;
+
+            __m256 firstU = _mm256_mul_ps(lerp(gu, x, y), inv_hx);
+            __m256 firstV = _mm256_mul_ps(lerp(gv, x, y), inv_hx);
+
+            __m256 half = _mm256_mul_ps(_mm256_set1_ps(0.5f), dt);
+            __m256 midX = _mm256_fnmadd_ps(half, firstU, x);
+            __m256 midY = _mm256_fnmadd_ps(half, firstV, y);
+
+            __m256 midU = _mm256_mul_ps(lerp(gu, midX, midY), inv_hx);
+            __m256 midV = _mm256_mul_ps(lerp(gv, midX, midY), inv_hx);
+
+            __m256 three_quarters = _mm256_mul_ps(_mm256_set1_ps(0.75f), dt);
+            __m256 lastX = _mm256_fnmadd_ps(three_quarters, midU, x);
+            __m256 lastY = _mm256_fnmadd_ps(three_quarters, midV, y);
+
+            __m256 lastU = lerp(gu, lastX, lastY);
+            __m256 lastV = lerp(gv, lastX, lastY);
+
+            __m256 c1 = _mm256_set1_ps(2.0f/9.0f);
+            __m256 c2 = _mm256_set1_ps(3.0f/9.0f);
+            __m256 c3 = _mm256_set1_ps(4.0f/9.0f);
+            __m256 du = _mm256_fmadd_ps(c1, firstU, _mm256_fmadd_ps(c2, midU, _mm256_mul_ps(c3, lastU)));
+            __m256 dv = _mm256_fmadd_ps(c1, firstV, _mm256_fmadd_ps(c2, midV, _mm256_mul_ps(c3, lastV)));
+            x = _mm256_fnmadd_ps(dt, du, x);
+            y = _mm256_fnmadd_ps(dt, dv, y);
+
+            _mm256_storeu_ps(dst + ix + iy*q._w, cerp(self, x, y));
+        }
+        q.advect(timestep, hx, u, v, ix, x1, iy, dst);
     }
-    return true;
 }
+#endif
 
+/*
+ * The suite owns a single FluidSolver, allocated in prepare() and released
+ * in teardown(). The reference answer stays in the on-disk cache and is
+ * compared through a read-only mapping, so it costs page cache rather than
+ * anonymous memory; it is only held in memory when the cache is not writable.
+ */
 struct fluid_solver : public pool_bench::suite
 {
     size_t _grid_size;
     size_t _problem_size;
-    FluidSolver _solver;
-    FluidSolver _solver_blank;
-    FluidSolver _solver_answer;
+    std::unique_ptr<FluidSolver> _solver;
+    std::vector<pool_bench::mapped_reference> _answer_files;
+    std::vector<std::vector<double>> _answer_copies;
     double _epsilon;
     double _timestep;
+    int _row_block;
+    int _project_limit;
+    int _tile_w;
+    int _tile_h;
+    bool _use_parallel_for;
 
-    fluid_solver()
+    fluid_solver(bool use_parallel_for = false)
         :_grid_size(2048),
          _problem_size(_grid_size * 3 * 4),
-        _solver_answer(_grid_size, _grid_size, 0.1),
-        _solver_blank(_grid_size, _grid_size, 0.1), 
-        _solver(_grid_size, _grid_size, 0.1), 
-        _epsilon(1e-4),
-        _timestep(0.05)
+         _epsilon(1e-4),
+         _timestep(0.05),
+         _row_block(32),
+         _project_limit(1000),
+         _tile_w(256),
+         _tile_h(32),
+         _use_parallel_for(use_parallel_for)
     {}
 
     size_t
@@ -361,125 +757,695 @@ struct fluid_solver : public pool_bench::suite
         return "Fluid Solver";
     }
 
+    double const*
+    answer(size_t field) const
+    {
+        if(!_answer_copies.empty())
+            return _answer_copies[field].data();
+        return static_cast<double const*>(_answer_files[field].data());
+    }
+
     bool check_result() override
     {
-        return is_equal(_solver, _solver_answer, _epsilon);
+        return is_equal(_solver->_d, answer(0), _epsilon)
+            && is_equal(_solver->_u, answer(1), _epsilon)
+            && is_equal(_solver->_v, answer(2), _epsilon);
     }
     
+    std::string
+    cache_path(char const* field) const
+    {
+        return pool_bench::reference::cache_path(
+            "fluid solver "s + field, "red-black-inflow", _grid_size, 0);
+    }
+
+    bool
+    load_answer()
+    {
+        FluidQuantity* fields[] = {&_solver->_d, &_solver->_u, &_solver->_v};
+        char const* names[] = {"density", "u", "v"};
+
+        _answer_files.clear();
+        for(size_t i = 0; i < 3; ++i)
+        {
+            auto bytes = fields[i]->_src.size() * sizeof(double);
+            _answer_files.emplace_back(pool_bench::reference::load(cache_path(names[i]), bytes));
+            if(!_answer_files.back())
+                return false;
+        }
+        return true;
+    }
+
+    bool
+    store_answer()
+    {
+        FluidQuantity* fields[] = {&_solver->_d, &_solver->_u, &_solver->_v};
+        char const* names[] = {"density", "u", "v"};
+        bool stored = true;
+        for(size_t i = 0; i < 3; ++i)
+            stored = pool_bench::reference::store(cache_path(names[i]),
+                                                  fields[i]->_src.data(),
+                                                  fields[i]->_src.size() * sizeof(double))
+                && stored;
+        return stored;
+    }
+
     void prepare() override
     {
-        _solver_blank = _solver_answer;
+        _solver.reset(new FluidSolver(_grid_size, _grid_size, 0.1));
+        if(!load_answer())
+            compute_answer();
+
+        /* An empty scene would make any indexing pass check_result */
+        auto density = answer(0);
+        if(std::all_of(density, density + _solver->_d._src.size(),
+                       [](double d){ return d == 0.0; }))
+            throw std::runtime_error("Error: reference density of \""s + name()
+                                     + "\" is all zero"s);
+    }
 
+    /* The serial answer is computed in place and the solver reset after */
+    void
+    compute_answer()
+    {
+        reset();
         for(size_t i = 0; i < 4; ++i)
         {
-            _solver_answer.buildRhs();
-            _solver_answer.project(1000, _timestep);
-            _solver_answer.applyPressure(_timestep);
+            _solver->buildRhs();
+            _solver->project(_project_limit, _timestep);
+            _solver->applyPressure(_timestep);
 
-            _solver_answer._d.advect(_timestep, _solver_answer._u, _solver_answer._v);
-            _solver_answer._u.advect(_timestep, _solver_answer._u, _solver_answer._v);
-            _solver_answer._v.advect(_timestep, _solver_answer._u, _solver_answer._v);
+            _solver->_d.advect(_timestep, _solver->_u, _solver->_v);
+            _solver->_u.advect(_timestep, _solver->_u, _solver->_v);
+            _solver->_v.advect(_timestep, _solver->_u, _solver->_v);
 
-            _solver_answer._d.flip();
-            _solver_answer._u.flip();
-            _solver_answer._v.flip();
+            _solver->_d.flip();
+            _solver->_u.flip();
+            _solver->_v.flip();
+        }
+
+        if(!store_answer() || !load_answer())
+        {
+            _answer_files.clear();
+            for(auto field : {&_solver->_d, &_solver->_u, &_solver->_v})
+                _answer_copies.emplace_back(field->_src);
         }
     }
 
-    void teardown() override {}
+    /* A jet rising from near the bottom, as in the original demo, so the
+     * pressure solve has a divergent field to work on from the first step */
+    void reset() override
+    {
+        _solver->reset();
+        _solver->addInflow(0.45, 0.2, 0.1, 0.01, 1.0, 0.0, 3.0);
+    }
 
+    void teardown() override
+    {
+        _solver.reset();
+        _answer_files.clear();
+        _answer_copies.clear();
+    }
+
+    template<typename F>
     void
-    run(std::function<
-        std::future<void>(std::function<void(void)>&&)>&& async) override
+    for_each_row_block(pool_bench::executor& async, F f)
+    {
+        if(_use_parallel_for)
+        {
+            pool_bench::barrier wait;
+            async.parallel_for(0, _solver->_h, _row_block,
+                               [&f](size_t y0, size_t y1)
+                               { f(static_cast<int>(y0), static_cast<int>(y1)); });
+            return;
+        }
+
+        auto tasks = std::vector<std::future<void>>();
+        for(int y0 = 0; y0 < _solver->_h; y0 += _row_block)
+        {
+            int y1 = std::min(y0 + _row_block, _solver->_h);
+            tasks.emplace_back(async([=]{ f(y0, y1); }));
+        }
+        pool_bench::join(tasks);
+    }
+
+    /* The stages that touch the advected quantities, over rows [y0, y1) */
+    virtual void
+    build_rhs(int y0, int y1)
     {
-        _solver = _solver_blank;
+        _solver->buildRhs(y0, y1);
+    }
 
+    virtual void
+    apply_pressure(int y0, int y1)
+    {
+        _solver->applyPressure(y0, y1, _timestep);
+    }
+
+    virtual void
+    flip()
+    {
+        _solver->_u.flip();
+        _solver->_d.flip();
+        _solver->_v.flip();
+    }
+
+    /* FluidSolver::project, with each color relaxed one task per row block
+     * and the convergence check reduced from the tasks' typed results. */
+    void
+    project(pool_bench::executor& async)
+    {
+        double scale = _solver->projectScale(_timestep);
+        auto deltas = std::vector<pool_bench::future<double>>();
+
+        for(int iter = 0; iter < _project_limit; iter++)
+        {
+            double maxDelta = 0.0;
+            for(int color = 0; color < 2; ++color)
+            {
+                if(_use_parallel_for)
+                {
+                    std::mutex lock;
+                    pool_bench::barrier wait;
+                    async.parallel_for(0, _solver->_h, _row_block,
+                                       [&, color, scale](size_t y0, size_t y1)
+                                       {
+                                           double delta = _solver->relax(color,
+                                                                         static_cast<int>(y0),
+                                                                         static_cast<int>(y1),
+                                                                         scale);
+                                           std::lock_guard<std::mutex> guard(lock);
+                                           maxDelta = std::max(maxDelta, delta);
+                                       });
+                    continue;
+                }
+
+                for(int y0 = 0; y0 < _solver->_h; y0 += _row_block)
+                {
+                    int y1 = std::min(y0 + _row_block, _solver->_h);
+                    deltas.emplace_back(async.submit(
+                            [=]{ return _solver->relax(color, y0, y1, scale); }));
+                }
+                {
+                    pool_bench::barrier wait;
+                    for(auto& i : deltas)
+                        maxDelta = std::max(maxDelta, i.get());
+                }
+                deltas.clear();
+            }
+
+            if(maxDelta < 1e-5)
+                return;
+        }
+    }
+
+    /* One task per _tile_w x _tile_h tile of each field, so rows are
+     * split as well when the grid is wide */
+    virtual void
+    advect(pool_bench::executor& async)
+    {
+        if(_use_parallel_for)
+        {
+            advect_rows(async);
+            return;
+        }
+
+        auto tasks = std::vector<std::future<void>>();
+        for(auto field : {&_solver->_d, &_solver->_u, &_solver->_v})
+        {
+            for(int y0 = 0; y0 < field->_h; y0 += _tile_h)
+            {
+                for(int x0 = 0; x0 < field->_w; x0 += _tile_w)
+                {
+                    int x1 = std::min(x0 + _tile_w, field->_w);
+                    int y1 = std::min(y0 + _tile_h, field->_h);
+                    tasks.emplace_back(async(
+                            [=]
+                            {
+                                field->advect(_timestep, _solver->_u, _solver->_v,
+                                              x0, y0, x1, y1);
+                            }));
+                }
+            }
+        }
+
+        pool_bench::join(tasks);
+    }
+
+    /* The rows of all three fields as one parallel_for, _tile_h rows at
+     * the least; a chunk may run across from one field into the next */
+    void
+    advect_rows(pool_bench::executor& async)
+    {
+        FluidQuantity* fields[] = {&_solver->_d, &_solver->_u, &_solver->_v};
+        int offsets[4] = {0};
+        for(size_t i = 0; i < 3; ++i)
+            offsets[i + 1] = offsets[i] + fields[i]->_h;
+
+        pool_bench::barrier wait;
+        async.parallel_for(0, offsets[3], _tile_h,
+                           [&](size_t first, size_t last)
+                           {
+                               for(size_t i = 0; i < 3; ++i)
+                               {
+                                   int y0 = std::max(static_cast<int>(first), offsets[i]) - offsets[i];
+                                   int y1 = std::min(static_cast<int>(last), offsets[i + 1]) - offsets[i];
+                                   if(y0 < y1)
+                                       fields[i]->advect(_timestep, _solver->_u, _solver->_v,
+                                                         0, y0, fields[i]->_w, y1);
+                               }
+                           });
+    }
+
+    void
+    run(pool_bench::executor&& async) override
+    {
         for(size_t i = 0; i < 4; ++i)
         {
-            auto tasks = std::vector<std::future<void>>();
-            tasks.reserve(_grid_size);
+            {
+                pool_bench::phase scope("rhs");
+                for_each_row_block(async, [this](int y0, int y1)
+                                          { build_rhs(y0, y1); });
+            }
+            {
+                pool_bench::phase scope("projection");
+                project(async);
+            }
+            {
+                pool_bench::phase scope("pressure");
+                for_each_row_block(async, [this](int y0, int y1)
+                                          { apply_pressure(y0, y1); });
+            }
+            {
+                pool_bench::phase scope("advection");
+                advect(async);
+            }
+            {
+                pool_bench::phase scope("flip");
+                flip();
+            }
+        }
+    }
+};
 
-            _solver.buildRhs();
-            _solver.project(1000, _timestep);
-            _solver.applyPressure(_timestep);
+/*
+ * The advected quantities in single precision: density and velocity live in
+ * FluidQuantityF grids from reset() on, the right hand side and pressure
+ * update read and write them as floats, and every tile is integrated and
+ * interpolated 8 cells at a time with AVX2 gathers (the scalar float path on
+ * other machines). Only the pressure solve stays in double. The grids are
+ * widened once, for check_result(), so a step moves half the bytes of the
+ * plain suite's advection; the looser epsilon absorbs the rounding.
+ */
+struct fluid_solver_simd : public fluid_solver
+{
+    simd::isa _isa;
+    std::string _name;
+    FluidQuantityF _d;
+    FluidQuantityF _u;
+    FluidQuantityF _v;
+
+    fluid_solver_simd()
+        :_isa(simd::detect_isa())
+    {
+        /* AVX-512 machines run the AVX2 kernel, gathers are no wider there */
+        if(_isa == simd::isa::avx512)
+            _isa = simd::isa::avx2;
+        _name = "Fluid Solver (simd "s + simd::isa_name(_isa) + ")";
+        _epsilon = 2e-4;
+    }
+
+    char const*
+    name() override
+    {
+        return _name.c_str();
+    }
+
+    bool check_result() override
+    {
+        _d.widen(_solver->_d);
+        _u.widen(_solver->_u);
+        _v.widen(_solver->_v);
+        return fluid_solver::check_result();
+    }
 
-            for(size_t j = 0; j < _grid_size; ++j)
+    void reset() override
+    {
+        fluid_solver::reset();
+        _d.assign(_solver->_d);
+        _u.assign(_solver->_u);
+        _v.assign(_solver->_v);
+    }
+
+    void teardown() override
+    {
+        fluid_solver::teardown();
+        _d = FluidQuantityF();
+        _u = FluidQuantityF();
+        _v = FluidQuantityF();
+    }
+
+    /* FluidSolver::buildRhs on the float velocity */
+    void
+    build_rhs(int y0, int y1) override
+    {
+        int w = _solver->_w;
+        double scale = 1.0/_solver->_hx;
+        for(int y = y0; y < y1; y++)
+            for(int x = 0, idx = y*w; x < w; x++, idx++)
+                _solver->_r[idx] = -scale*((double)_u.at(x + 1, y) - _u.at(x, y) +
+                                           _v.at(x, y + 1) - _v.at(x, y));
+    }
+
+    /* FluidSolver::applyPressure on the float velocity */
+    void
+    apply_pressure(int y0, int y1) override
+    {
+        int w = _solver->_w;
+        int h = _solver->_h;
+        double const* p = _solver->_p.data();
+        double scale = _timestep/(_solver->_density*_solver->_hx);
+
+        for(int y = y0; y < y1; y++)
+        {
+            for(int x = 1; x < w; x++)
+                _u.at(x, y) = (float)(_u.at(x, y) + scale*p[x - 1 + y*w] - scale*p[x + y*w]);
+            _u.at(0, y) = _u.at(w, y) = 0.0f;
+
+            if(y == 0)
             {
-                auto d_advect =
-                    [this, j]
-                    {
-                        size_t idx = 0;
-                        size_t iy = j;
-                        for (int ix = 0; ix < _solver._w; ix++, idx++) {
-                            double x = ix + _solver._d._ox;
-                            double y = iy + _solver._d._oy;
-                
-                            _solver._d.rungeKutta3(x, y,
-                                                   _timestep,
-                                                   _solver._u,
-                                                   _solver._v);
-                
-                            _solver._d._dst[idx] = _solver._d.cerp(x, y);
-                        }
-                    };
-                
-                tasks.emplace_back(async(d_advect));
+                for(int x = 0; x < w; x++)
+                    _v.at(x, 0) = 0.0f;
+                continue;
             }
+            for(int x = 0; x < w; x++)
+                _v.at(x, y) = (float)(_v.at(x, y) + scale*p[x + (y - 1)*w] - scale*p[x + y*w]);
+        }
+
+        if(y1 == h)
+        {
+            for(int x = 0; x < w; x++)
+                _v.at(x, h) = 0.0f;
+        }
+    }
 
-            for(size_t j = 0; j < _grid_size; ++j)
+    void
+    flip() override
+    {
+        _u.flip();
+        _d.flip();
+        _v.flip();
+    }
+
+    void
+    advect_row(FluidQuantityF& q, int x0, int x1, int iy)
+    {
+        float timestep = (float)_timestep;
+        float hx = (float)_solver->_hx;
+#if POOL_BENCH_X86_SIMD
+        if(_isa == simd::isa::avx2)
+        {
+            advect_avx2::advect(q, timestep, hx, _u, _v, x0, x1, iy, q._dst.data());
+            return;
+        }
+#endif
+        q.advect(timestep, hx, _u, _v, x0, x1, iy, q._dst.data());
+    }
+
+    void
+    advect(pool_bench::executor& async) override
+    {
+        auto tasks = std::vector<std::future<void>>();
+        for(auto field : {&_d, &_u, &_v})
+        {
+            for(int y0 = 0; y0 < field->_h; y0 += _tile_h)
             {
-                auto u_advect =
-                    [this, j]
-                    {
-                        size_t idx = 0;
-                        size_t iy = j;
-                        for (int ix = 0; ix < _solver._w; ix++, idx++) {
-                            double x = ix + _solver._u._ox;
-                            double y = iy + _solver._u._oy;
-                
-                            _solver._u.rungeKutta3(x, y,
-                                                   _timestep,
-                                                   _solver._u,
-                                                   _solver._v);
-                
-                            _solver._u._dst[idx] = _solver._u.cerp(x, y);
-                        }
-                    };
+                for(int x0 = 0; x0 < field->_w; x0 += _tile_w)
+                {
+                    int x1 = std::min(x0 + _tile_w, field->_w);
+                    int y1 = std::min(y0 + _tile_h, field->_h);
+                    tasks.emplace_back(async(
+                            [=]
+                            {
+                                for(int iy = y0; iy < y1; ++iy)
+                                    advect_row(*field, x0, x1, iy);
+                            }));
+                }
+            }
+        }
+        pool_bench::join(tasks);
+    }
+};
+
+/*
+ * Every row loop of the plain suite handed to the pool's own
+ * parallel_for, with _row_block and _tile_h as the grain, instead of
+ * one submitted task per row block or tile.
+ */
+struct fluid_solver_parallel_for : public fluid_solver
+{
+    fluid_solver_parallel_for()
+        :fluid_solver(true)
+    {}
+
+    char const*
+    name() override
+    {
+        return "Fluid Solver (parallel_for)";
+    }
+};
 
-                tasks.emplace_back(async(u_advect));
+REGISTER_BENCHMARK(fluid_solver)
+REGISTER_BENCHMARK(fluid_solver_simd)
+REGISTER_BENCHMARK(fluid_solver_parallel_for)
+
+/*
+ * Density advected for _steps timesteps through a fixed vortex, one task per
+ * row block and step. Backtraced positions move at most a CFL bound's worth
+ * of rows and the cubic stencil reaches two rows further, so a block of step
+ * t + 1 only reads the blocks of step t within _reach blocks of it.
+ * With _pipelined set, each task counts down its neighbours in the next step
+ * and submits the ones it completes, so steps overlap instead of meeting at
+ * a barrier; otherwise every step is joined before the next is submitted.
+ */
+struct fluid_advection : public pool_bench::suite
+{
+    size_t _grid_size;
+    int _steps;
+    int _row_block;
+    double _timestep;
+    double _epsilon;
+    bool _pipelined;
+
+    /* Steps alternate between the two density buffers */
+    std::unique_ptr<FluidQuantity> _density[2];
+    std::unique_ptr<FluidQuantity> _u;
+    std::unique_ptr<FluidQuantity> _v;
+    std::vector<double> _answer;
+    int _reach;
+
+    std::vector<std::atomic<int>> _pending;
+    std::vector<std::future<void>> _tasks;
+    std::atomic<size_t> _remaining;
+    std::promise<void> _done;
+
+    fluid_advection(bool pipelined = false)
+        :_grid_size(2048),
+         _steps(8),
+         _row_block(32),
+         _timestep(0.05),
+         _epsilon(1e-4),
+         _pipelined(pipelined),
+         _reach(0),
+         _remaining(0)
+    {}
+
+    int
+    blocks() const
+    {
+        return (static_cast<int>(_grid_size) + _row_block - 1) / _row_block;
+    }
+
+    size_t
+    problem_size() override
+    {
+        return static_cast<size_t>(_steps) * blocks();
+    }
+
+    char const*
+    name() override
+    {
+        return _pipelined
+            ? "Fluid Advection (pipelined)"
+            : "Fluid Advection";
+    }
+
+    bool check_result() override
+    {
+        auto& result = _density[_steps % 2]->src();
+        for(size_t i = 0; i < result.size(); ++i)
+        {
+            if(std::abs(result[i] - _answer[i]) > _epsilon)
+                return false;
+        }
+        return true;
+    }
+
+    void
+    advect_block(int step, int block)
+    {
+        auto& src = *_density[step % 2];
+        auto& dst = *_density[(step + 1) % 2];
+        int y0 = block * _row_block;
+        int y1 = std::min(y0 + _row_block, src._h);
+        src.advect(_timestep, *_u, *_v, 0, y0, src._w, y1, dst._src);
+    }
+
+    void prepare() override
+    {
+        int n = static_cast<int>(_grid_size);
+        double hx = 1.0/n;
+        _density[0].reset(new FluidQuantity(n, n, 0.5, 0.5, hx));
+        _density[1].reset(new FluidQuantity(n, n, 0.5, 0.5, hx));
+        _u.reset(new FluidQuantity(n + 1, n, 0.0, 0.5, hx));
+        _v.reset(new FluidQuantity(n, n + 1, 0.5, 0.0, hx));
+
+        /* Solid body rotation about the centre, about 8 cells per step at
+         * the corners */
+        double spin = 0.1;
+        double speed = 0.0;
+        for (int y = 0; y < _u->_h; y++)
+            for (int x = 0; x < _u->_w; x++) {
+                _u->at(x, y) = -spin*((y + _u->_oy)*hx - 0.5);
+                speed = std::max(speed, fabs(_u->at(x, y)));
+            }
+        for (int y = 0; y < _v->_h; y++)
+            for (int x = 0; x < _v->_w; x++) {
+                _v->at(x, y) = spin*((x + _v->_ox)*hx - 0.5);
+                speed = std::max(speed, fabs(_v->at(x, y)));
             }
 
-            for(size_t j = 0; j < _grid_size; ++j)
+        /* rungeKutta3 leaves its last stage unscaled by 1/hx, so the bound
+         * is taken over both forms; the cubic stencil adds two rows */
+        double rows = _timestep*speed*std::max(1.0/hx, (5.0/9.0)/hx + 4.0/9.0);
+        _reach = (static_cast<int>(std::ceil(rows)) + 2 + _row_block - 1) / _row_block;
+
+        _pending = std::vector<std::atomic<int>>(problem_size());
+        _tasks.resize(problem_size());
+
+        _answer.resize(_density[0]->_src.size());
+        auto path = pool_bench::reference::cache_path(
+            "fluid advection", "vortex", _grid_size, _steps);
+        pool_bench::reference::cached(path, _answer, [this](std::vector<double>& answer)
+        {
+            reset();
+            for(int step = 0; step < _steps; ++step)
+                for(int block = 0; block < blocks(); ++block)
+                    advect_block(step, block);
+            answer = _density[_steps % 2]->_src;
+        });
+    }
+
+    void reset() override
+    {
+        _density[0]->reset();
+        _density[1]->reset();
+        _density[0]->addInflow(0.20, 0.20, 0.45, 0.45, 1.0);
+        _density[0]->addInflow(0.55, 0.30, 0.80, 0.55, 0.8);
+        _density[0]->addInflow(0.35, 0.60, 0.60, 0.85, 0.6);
+    }
+
+    void teardown() override
+    {
+        _density[0].reset();
+        _density[1].reset();
+        _u.reset();
+        _v.reset();
+        _answer = std::vector<double>();
+        _pending = std::vector<std::atomic<int>>();
+        _tasks = std::vector<std::future<void>>();
+    }
+
+    int
+    dependencies(int block) const
+    {
+        return std::min(block + _reach, blocks() - 1)
+            - std::max(block - _reach, 0) + 1;
+    }
+
+    void
+    submit(pool_bench::executor& async, int step, int block)
+    {
+        _tasks[step * blocks() + block] = async(
+            [this, &async, step, block]
             {
-                auto v_advect =
-                    [this, j]
+                advect_block(step, block);
+
+                if(step + 1 < _steps)
+                {
+                    int first = std::max(block - _reach, 0);
+                    int last = std::min(block + _reach, blocks() - 1);
+                    for(int next = first; next <= last; ++next)
                     {
-                        size_t idx = 0;
-                        size_t iy = j;
-                        for (int ix = 0; ix < _solver._w; ix++, idx++) {
-                            double x = ix + _solver._v._ox;
-                            double y = iy + _solver._v._oy;
-                
-                            _solver._v.rungeKutta3(x, y,
-                                                   _timestep,
-                                                   _solver._u,
-                                                   _solver._v);
-                
-                            _solver._v._dst[idx] = _solver._v.cerp(x, y);
-                        }
-                    };
+                        if(--_pending[(step + 1) * blocks() + next] == 0)
+                            submit(async, step + 1, next);
+                    }
+                }
 
-                tasks.emplace_back(async(v_advect));
-            }
+                /* Every submission made by this task is stored by now */
+                if(--_remaining == 0)
+                    _done.set_value();
+            });
+    }
+
+    void
+    run_pipelined(pool_bench::executor& async)
+    {
+        for(int step = 1; step < _steps; ++step)
+            for(int block = 0; block < blocks(); ++block)
+                _pending[step * blocks() + block] = dependencies(block);
+        _remaining = problem_size();
+        _done = std::promise<void>();
+
+        for(int block = 0; block < blocks(); ++block)
+            submit(async, 0, block);
 
-            for(auto& i : tasks)
-                i.get();
+        pool_bench::barrier wait;
+        _done.get_future().wait();
+        for(auto& i : _tasks)
+            i.get();
+    }
 
-            _solver._u.flip();
-            _solver._d.flip();
-            _solver._v.flip();
+    void
+    run_stepped(pool_bench::executor& async)
+    {
+        auto tasks = std::vector<std::future<void>>();
+        for(int step = 0; step < _steps; ++step)
+        {
+            for(int block = 0; block < blocks(); ++block)
+                tasks.emplace_back(async([=]{ advect_block(step, block); }));
+            pool_bench::join(tasks);
+            tasks.clear();
         }
     }
+
+    void
+    run(pool_bench::executor&& async) override
+    {
+        pool_bench::phase scope("advection");
+        if(_pipelined)
+            run_pipelined(async);
+        else
+            run_stepped(async);
+    }
 };
 
-REGISTER_BENCHMARK(fluid_solver)
+struct pipelined_fluid_advection : public fluid_advection
+{
+    pipelined_fluid_advection()
+        : fluid_advection(true)
+    {}
+};
+
+REGISTER_BENCHMARK(fluid_advection)
+REGISTER_BENCHMARK(pipelined_fluid_advection)
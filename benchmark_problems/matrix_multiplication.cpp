@@ -17,20 +17,26 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <cmath>
 #include <functional>
 #include <future>
-#include <random>
+#include <string>
 
 #include <pool_bench.hpp>
+#include <pool_bench_reference.hpp>
+#include "simd.hpp"
 
-template<typename Dist, typename Rng, typename It>
+using namespace std::string_literals;
+
+template<typename Gen, typename It>
 inline void
-generate_random(Dist& dist, Rng& rng, It begin, It end)
+generate_random(Gen& gen, It begin, It end)
 {
     for(It it = begin; it != end; ++it) {
-        *it = dist(rng);
+        *it = gen();
     }
 }
 
@@ -48,14 +54,18 @@ struct matrix_multiplication : public pool_bench::suite
     std::vector<float> _C; 
     std::vector<float> _C_answer; 
     float _epsilon;
+    uint32_t _seed;
+    bool _use_parallel_for;
 
-    matrix_multiplication()
+    matrix_multiplication(bool use_parallel_for = false)
         :_problem_size(1024),
          _A(_problem_size * _problem_size),
          _B(_problem_size * _problem_size),
          _C(_problem_size * _problem_size),
          _C_answer(_problem_size * _problem_size),
-         _epsilon(1e-6)
+         _epsilon(1e-5),
+         _seed(2018),
+         _use_parallel_for(use_parallel_for)
     {}
 
     size_t
@@ -70,44 +80,60 @@ struct matrix_multiplication : public pool_bench::suite
         return "matrix multiplication";
     }
 
+    /* _epsilon is relative to the element, absolute below magnitude one */
     bool check_result() override
     {
         for(size_t i = 0; i < _C.size(); ++i)
         {
-            if(std::abs(_C_answer[i] - _C[i]) >= _epsilon)
+            auto scale = std::max(1.0f, std::abs(_C_answer[i]));
+            if(std::abs(_C_answer[i] - _C[i]) > _epsilon * scale)
                 return false;
         }
         return true;
     }
     
-    void prepare() override
+    /*
+     * Serial reference, walking C and A column by column.
+     * Every element still accumulates in increasing l from zero, so the
+     * answer is identical to the naive triple loop.
+     */
+    void
+    reference_product(std::vector<float>& C) const
     {
-        std::random_device seed;
-        std::mt19937 rng(seed());
-        std::normal_distribution<float> dist(0, 1);
-
-        generate_random(dist, rng, _A.begin(), _A.end());
-        generate_random(dist, rng, _B.begin(), _B.end());
-
         size_t m = _problem_size;
         size_t k = _problem_size;
         size_t n = _problem_size;
-        for(size_t i = 0; i < m; ++i)
+        std::fill(C.begin(), C.end(), 0.0f);
+        for(size_t j = 0; j < n; ++j)
         {
-            for(size_t j = 0; j < n; ++j) {
-                float sum = 0;
-                for(size_t l = 0; l < k; ++l)
-                    sum += _A[index(i, l, k)] * _B[index(l, j, n)];
-                _C_answer[index(i, j, n)] = sum;
+            float* c = &C[index(0, j, n)];
+            for(size_t l = 0; l < k; ++l)
+            {
+                float b = _B[index(l, j, n)];
+                float const* a = &_A[index(0, l, k)];
+                for(size_t i = 0; i < m; ++i)
+                    c[i] += a[i] * b;
             }
         }
     }
 
+    void prepare() override
+    {
+        pool_bench::normal_generator rng(_seed);
+        generate_random(rng, _A.begin(), _A.end());
+        generate_random(rng, _B.begin(), _B.end());
+
+        auto path = pool_bench::reference::cache_path(
+            "matrix multiplication", "column", _problem_size, _seed);
+        pool_bench::reference::cached(path, _C_answer,
+                                      [this](std::vector<float>& C)
+                                      { reference_product(C); });
+    }
+
     void teardown() override {}
 
     void
-    run(std::function<
-        std::future<void>(std::function<void(void)>&&)>&& async) override
+    run(pool_bench::executor&& async) override
     {
         auto task = [this](size_t i)
                     {
@@ -121,6 +147,17 @@ struct matrix_multiplication : public pool_bench::suite
                         }
                     };
 
+        if(_use_parallel_for)
+        {
+            async.parallel_for(0, _problem_size, 1,
+                               [&task](size_t first, size_t last)
+                               {
+                                   for(size_t i = first; i < last; ++i)
+                                       task(i);
+                               });
+            return;
+        }
+
         auto tasks = std::vector<std::future<void>>();
         tasks.reserve(_problem_size);
 
@@ -134,3 +171,366 @@ struct matrix_multiplication : public pool_bench::suite
 };
 
 REGISTER_BENCHMARK(matrix_multiplication)
+
+/*
+ * Same rows handed to the pool's own parallel_for, which decides how
+ * to split them, instead of one submitted task per row.
+ */
+struct matrix_multiplication_parallel_for : public matrix_multiplication
+{
+    matrix_multiplication_parallel_for()
+        :matrix_multiplication(true)
+    {}
+
+    char const*
+    name() override
+    {
+        return "matrix multiplication (parallel_for)";
+    }
+};
+
+REGISTER_BENCHMARK(matrix_multiplication_parallel_for)
+
+/*
+ * Same product, one task per (row block, column block) tile of C.
+ * The kernel walks the shared dimension in blocks of _depth and keeps
+ * the innermost loop on contiguous columns of A and C, so the tile size
+ * alone decides the task granularity.
+ */
+struct tiled_matrix_multiplication : public matrix_multiplication
+{
+    size_t _tile;
+    size_t _depth;
+    std::string _name;
+
+    tiled_matrix_multiplication(size_t tile)
+        :matrix_multiplication(),
+         _tile(tile),
+         _depth(64),
+         _name("matrix multiplication (tile "s + std::to_string(tile) + ")"s)
+    {
+        _epsilon = 1e-3;
+    }
+
+    size_t
+    tiles() const
+    {
+        return (_problem_size + _tile - 1) / _tile;
+    }
+
+    size_t
+    problem_size() override
+    {
+        return tiles() * tiles();
+    }
+
+    char const*
+    name() override
+    {
+        return _name.c_str();
+    }
+
+    void
+    multiply_tile(size_t i0, size_t j0)
+    {
+        size_t m = _problem_size;
+        size_t k = _problem_size;
+        size_t n = _problem_size;
+        size_t i1 = std::min(i0 + _tile, m);
+        size_t j1 = std::min(j0 + _tile, n);
+
+        for(size_t j = j0; j < j1; ++j)
+            std::fill(_C.data() + index(i0, j, n), _C.data() + index(i1, j, n), 0.0f);
+
+        for(size_t l0 = 0; l0 < k; l0 += _depth)
+        {
+            size_t l1 = std::min(l0 + _depth, k);
+            for(size_t j = j0; j < j1; ++j)
+            {
+                float* c = &_C[index(0, j, n)];
+                for(size_t l = l0; l < l1; ++l)
+                {
+                    float b = _B[index(l, j, n)];
+                    float const* a = &_A[index(0, l, k)];
+                    for(size_t i = i0; i < i1; ++i)
+                        c[i] += a[i] * b;
+                }
+            }
+        }
+    }
+
+    void
+    run(pool_bench::executor&& async) override
+    {
+        auto tasks = std::vector<std::future<void>>();
+        tasks.reserve(problem_size());
+
+        for(size_t i = 0; i < _problem_size; i += _tile)
+        {
+            for(size_t j = 0; j < _problem_size; j += _tile)
+                tasks.emplace_back(async([=]{ multiply_tile(i, j); }));
+        }
+
+        for(auto& i : tasks)
+            i.get();
+    }
+};
+
+static tiled_matrix_multiplication _tiled_matrix_multiplication_16{16};
+static tiled_matrix_multiplication _tiled_matrix_multiplication_32{32};
+static tiled_matrix_multiplication _tiled_matrix_multiplication_64{64};
+static tiled_matrix_multiplication _tiled_matrix_multiplication_128{128};
+static tiled_matrix_multiplication _tiled_matrix_multiplication_256{256};
+
+namespace simd
+{
+    /*
+     * Computes an mr x nr block of C over the whole shared dimension from a
+     * packed panel of A (mr rows, contiguous per l) and a packed panel of B
+     * (nr columns, contiguous per l). The block is stored column major.
+     */
+    struct micro_kernel
+    {
+        simd::isa set;
+        size_t mr;
+        size_t nr;
+        void (*run)(size_t k, float const* a, float const* b, float* c);
+    };
+
+    template<size_t MR, size_t NR>
+    inline void
+    kernel_scalar(size_t k, float const* a, float const* b, float* c)
+    {
+        float acc[MR * NR] = {};
+        for(size_t l = 0; l < k; ++l)
+        {
+            for(size_t j = 0; j < NR; ++j)
+            {
+                float bj = b[l * NR + j];
+                for(size_t i = 0; i < MR; ++i)
+                    acc[j * MR + i] += a[l * MR + i] * bj;
+            }
+        }
+        std::copy(acc, acc + MR * NR, c);
+    }
+
+#if POOL_BENCH_X86_SIMD
+    POOL_BENCH_TARGET("avx2,fma")
+    inline void
+    kernel_avx2(size_t k, float const* a, float const* b, float* c)
+    {
+        __m256 acc[2][4];
+        for(size_t j = 0; j < 4; ++j)
+            acc[0][j] = acc[1][j] = _mm256_setzero_ps();
+
+        for(size_t l = 0; l < k; ++l)
+        {
+            __m256 a0 = _mm256_loadu_ps(a + l * 16);
+            __m256 a1 = _mm256_loadu_ps(a + l * 16 + 8);
+            for(size_t j = 0; j < 4; ++j)
+            {
+                __m256 bj = _mm256_broadcast_ss(b + l * 4 + j);
+                acc[0][j] = _mm256_fmadd_ps(a0, bj, acc[0][j]);
+                acc[1][j] = _mm256_fmadd_ps(a1, bj, acc[1][j]);
+            }
+        }
+
+        for(size_t j = 0; j < 4; ++j)
+        {
+            _mm256_storeu_ps(c + j * 16, acc[0][j]);
+            _mm256_storeu_ps(c + j * 16 + 8, acc[1][j]);
+        }
+    }
+
+    POOL_BENCH_TARGET("avx512f")
+    inline void
+    kernel_avx512(size_t k, float const* a, float const* b, float* c)
+    {
+        __m512 acc[2][8];
+        for(size_t j = 0; j < 8; ++j)
+            acc[0][j] = acc[1][j] = _mm512_setzero_ps();
+
+        for(size_t l = 0; l < k; ++l)
+        {
+            __m512 a0 = _mm512_loadu_ps(a + l * 32);
+            __m512 a1 = _mm512_loadu_ps(a + l * 32 + 16);
+            for(size_t j = 0; j < 8; ++j)
+            {
+                __m512 bj = _mm512_set1_ps(b[l * 8 + j]);
+                acc[0][j] = _mm512_fmadd_ps(a0, bj, acc[0][j]);
+                acc[1][j] = _mm512_fmadd_ps(a1, bj, acc[1][j]);
+            }
+        }
+
+        for(size_t j = 0; j < 8; ++j)
+        {
+            _mm512_storeu_ps(c + j * 32, acc[0][j]);
+            _mm512_storeu_ps(c + j * 32 + 16, acc[1][j]);
+        }
+    }
+#endif
+
+    inline micro_kernel
+    select_kernel()
+    {
+        switch(simd::detect_isa())
+        {
+#if POOL_BENCH_X86_SIMD
+        case isa::avx512:
+            return {isa::avx512, 32, 8, &kernel_avx512};
+        case isa::avx2:
+            return {isa::avx2, 16, 4, &kernel_avx2};
+#endif
+        default:
+            return {isa::scalar, 16, 4, &kernel_scalar<16, 4>};
+        }
+    }
+}
+
+/*
+ * Same product through a register blocked micro kernel over packed panels,
+ * vectorized for the best instruction set the CPU reports at runtime.
+ * Each task covers a _tile x _tile block of C, which makes the tasks short
+ * and compute dense so that scheduling overhead becomes a visible share.
+ */
+struct simd_matrix_multiplication : public matrix_multiplication
+{
+    simd::micro_kernel _kernel;
+    size_t _tile;
+    std::string _name;
+    std::vector<float> _A_packed;
+    std::vector<float> _B_packed;
+
+    simd_matrix_multiplication()
+        :matrix_multiplication(),
+         _kernel(simd::select_kernel()),
+         _tile(64),
+         _name("matrix multiplication (simd "s + simd::isa_name(_kernel.set) + ")"s),
+         _A_packed(panels(_kernel.mr) * _kernel.mr * _problem_size),
+         _B_packed(panels(_kernel.nr) * _kernel.nr * _problem_size)
+    {
+        _epsilon = 1e-3;
+    }
+
+    size_t
+    panels(size_t width) const
+    {
+        return (_problem_size + width - 1) / width;
+    }
+
+    size_t
+    tiles() const
+    {
+        return (_problem_size + _tile - 1) / _tile;
+    }
+
+    size_t
+    problem_size() override
+    {
+        return tiles() * tiles() + 2 * tiles();
+    }
+
+    char const*
+    name() override
+    {
+        return _name.c_str();
+    }
+
+    /* Rows [i0, i1) of A into panels of mr rows, zero padded */
+    void
+    pack_A(size_t i0, size_t i1)
+    {
+        size_t m = _problem_size;
+        size_t k = _problem_size;
+        size_t mr = _kernel.mr;
+        for(size_t p = i0 / mr; p < (i1 + mr - 1) / mr; ++p)
+        {
+            float* panel = &_A_packed[p * mr * k];
+            for(size_t l = 0; l < k; ++l)
+            {
+                for(size_t r = 0; r < mr; ++r)
+                {
+                    size_t i = p * mr + r;
+                    panel[l * mr + r] = i < m ? _A[index(i, l, k)] : 0.0f;
+                }
+            }
+        }
+    }
+
+    /* Columns [j0, j1) of B into panels of nr columns, zero padded */
+    void
+    pack_B(size_t j0, size_t j1)
+    {
+        size_t k = _problem_size;
+        size_t n = _problem_size;
+        size_t nr = _kernel.nr;
+        for(size_t q = j0 / nr; q < (j1 + nr - 1) / nr; ++q)
+        {
+            float* panel = &_B_packed[q * nr * k];
+            for(size_t l = 0; l < k; ++l)
+            {
+                for(size_t c = 0; c < nr; ++c)
+                {
+                    size_t j = q * nr + c;
+                    panel[l * nr + c] = j < n ? _B[index(l, j, n)] : 0.0f;
+                }
+            }
+        }
+    }
+
+    void
+    multiply_tile(size_t i0, size_t j0)
+    {
+        size_t m = _problem_size;
+        size_t k = _problem_size;
+        size_t n = _problem_size;
+        size_t mr = _kernel.mr;
+        size_t nr = _kernel.nr;
+        size_t i1 = std::min(i0 + _tile, m);
+        size_t j1 = std::min(j0 + _tile, n);
+
+        float block[32 * 8];
+        for(size_t j = j0; j < j1; j += nr)
+        {
+            float const* b = &_B_packed[(j / nr) * nr * k];
+            for(size_t i = i0; i < i1; i += mr)
+            {
+                float const* a = &_A_packed[(i / mr) * mr * k];
+                _kernel.run(k, a, b, block);
+
+                for(size_t c = 0; c < std::min(nr, n - j); ++c)
+                    std::copy(&block[c * mr],
+                              &block[c * mr] + std::min(mr, m - i),
+                              &_C[index(i, j + c, n)]);
+            }
+        }
+    }
+
+    void
+    run(pool_bench::executor&& async) override
+    {
+        auto tasks = std::vector<std::future<void>>();
+        tasks.reserve(problem_size());
+
+        for(size_t i = 0; i < _problem_size; i += _tile)
+        {
+            size_t end = std::min(i + _tile, _problem_size);
+            tasks.emplace_back(async([=]{ pack_A(i, end); }));
+            tasks.emplace_back(async([=]{ pack_B(i, end); }));
+        }
+        for(auto& i : tasks)
+            i.get();
+        tasks.clear();
+
+        for(size_t i = 0; i < _problem_size; i += _tile)
+        {
+            for(size_t j = 0; j < _problem_size; j += _tile)
+                tasks.emplace_back(async([=]{ multiply_tile(i, j); }));
+        }
+
+        for(auto& i : tasks)
+            i.get();
+    }
+};
+
+REGISTER_BENCHMARK(simd_matrix_multiplication)
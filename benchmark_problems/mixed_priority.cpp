@@ -0,0 +1,159 @@
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018  Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pool_bench.hpp>
+
+namespace chrono = std::chrono;
+
+/*
+ * Interactive requests behind a batch job: a backlog of bulk tasks is
+ * queued at low priority up front, then a paced stream of small tasks is
+ * submitted at high priority while the backlog drains. The latency of
+ * each interactive task, from its submission until it starts, is what a
+ * pool with priorities keeps short; without them it is the backlog ahead.
+ */
+struct mixed_priority : public pool_bench::suite
+{
+    size_t _bulk_count;
+    size_t _bulk_iterations;
+    size_t _interactive_count;
+    size_t _interactive_iterations;
+    chrono::microseconds _interval;
+
+    std::vector<double> _results;
+    std::vector<double> _answer;
+    std::vector<chrono::nanoseconds> _latency;
+    chrono::nanoseconds _bulk_span;
+
+    mixed_priority()
+        :_bulk_count(128 * std::max(1u, std::thread::hardware_concurrency())),
+         _bulk_iterations(200000),
+         _interactive_count(256),
+         _interactive_iterations(200),
+         _interval(200),
+         _results(_bulk_count + _interactive_count),
+         _answer(_bulk_count + _interactive_count),
+         _latency(_interactive_count),
+         _bulk_span(0)
+    {}
+
+    size_t
+    problem_size() override
+    {
+        return _bulk_count + _interactive_count;
+    }
+
+    char const*
+    name() override
+    {
+        return "mixed priority";
+    }
+
+    bool check_result() override
+    {
+        return _results == _answer;
+    }
+
+    void prepare() override
+    {
+        for(size_t i = 0; i < _bulk_count; ++i)
+            _answer[i] = pool_bench::spin_work(i, _bulk_iterations);
+        for(size_t i = 0; i < _interactive_count; ++i)
+            _answer[_bulk_count + i] = pool_bench::spin_work(i, _interactive_iterations);
+    }
+
+    void teardown() override {}
+
+    void reset() override
+    {
+        std::fill(_results.begin(), _results.end(), 0.0);
+        std::fill(_latency.begin(), _latency.end(), chrono::nanoseconds(0));
+    }
+
+    void
+    run(pool_bench::executor&& async) override
+    {
+        auto bulk = std::vector<std::future<void>>();
+        bulk.reserve(_bulk_count);
+        auto interactive = std::vector<std::future<void>>();
+        interactive.reserve(_interactive_count);
+
+        auto span_start = chrono::steady_clock::now();
+        for(size_t i = 0; i < _bulk_count; ++i)
+        {
+            bulk.emplace_back(async(
+                    [this, i]
+                    {
+                        _results[i] = pool_bench::spin_work(i, _bulk_iterations);
+                    },
+                    pool_bench::priority::low));
+        }
+
+        auto next = chrono::steady_clock::now();
+        for(size_t i = 0; i < _interactive_count; ++i)
+        {
+            std::this_thread::sleep_until(next);
+            next += _interval;
+
+            auto submitted = chrono::steady_clock::now();
+            interactive.emplace_back(async(
+                    [this, i, submitted]
+                    {
+                        _latency[i] = chrono::steady_clock::now() - submitted;
+                        _results[_bulk_count + i] = pool_bench::spin_work(i, _interactive_iterations);
+                    },
+                    pool_bench::priority::high));
+        }
+
+        pool_bench::join(interactive);
+        pool_bench::join(bulk);
+        _bulk_span = chrono::steady_clock::now() - span_start;
+    }
+
+    /* Start latency of the high priority tasks, and the whole backlog's span */
+    std::string report() override
+    {
+        using float_microsec = chrono::duration<double, std::micro>;
+        auto sorted = _latency;
+        std::sort(sorted.begin(), sorted.end());
+        auto at = [&sorted](double quantile)
+                  {
+                      auto index = static_cast<size_t>(quantile * (sorted.size() - 1));
+                      return chrono::duration_cast<float_microsec>(sorted[index]).count();
+                  };
+
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer),
+                 "    high priority latency p50 %.1fus, p99 %.1fus, max %.1fus, backlog %.3fms",
+                 at(0.5),
+                 at(0.99),
+                 at(1.0),
+                 chrono::duration_cast<chrono::duration<double, std::milli>>(_bulk_span).count());
+        return buffer;
+    }
+};
+
+REGISTER_BENCHMARK(mixed_priority)
@@ -0,0 +1,266 @@
+
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018  Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <pool_bench.hpp>
+#include <pool_bench_reference.hpp>
+
+struct min_max
+{
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::lowest();
+
+    inline void
+    combine(min_max const& other)
+    {
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+    }
+};
+
+/*
+ * Sum, min/max and a histogram over a large array, one task per chunk.
+ * Each task hands back its partial aggregate through a typed future and the
+ * harness thread combines them in chunk order.
+ * With _shared_partials set, tasks instead write into packed arrays indexed
+ * by chunk, with the histogram laid out bin major so that neighbouring tasks
+ * keep writing to the same cache lines.
+ */
+struct parallel_reduction : public pool_bench::suite
+{
+    size_t _problem_size;
+    size_t _chunk_size;
+    size_t _bins;
+    float _range;
+    bool _shared_partials;
+
+    std::vector<float> _data;
+
+    double _sum;
+    min_max _extrema;
+    std::vector<uint32_t> _histogram;
+
+    double _sum_answer;
+    min_max _extrema_answer;
+    std::vector<uint32_t> _histogram_answer;
+
+    std::vector<double> _shared_sum;
+    std::vector<min_max> _shared_extrema;
+    std::vector<uint32_t> _shared_histogram;
+
+    parallel_reduction(bool shared_partials = false)
+        :_problem_size(1 << 23),
+         _chunk_size(1 << 15),
+         _bins(256),
+         _range(4.0f),
+         _shared_partials(shared_partials),
+         _data(_problem_size),
+         _sum(0),
+         _histogram(_bins),
+         _sum_answer(0),
+         _histogram_answer(_bins)
+    {}
+
+    size_t
+    chunks() const
+    {
+        return _problem_size / _chunk_size;
+    }
+
+    size_t
+    problem_size() override
+    {
+        return chunks() * 3;
+    }
+
+    char const*
+    name() override
+    {
+        return _shared_partials
+            ? "parallel reduction (shared partials)"
+            : "parallel reduction";
+    }
+
+    size_t
+    bin(float x) const
+    {
+        auto scaled = (x + _range) / (2 * _range) * _bins;
+        auto clamped = std::min(std::max(scaled, 0.0f), _bins - 1.0f);
+        return static_cast<size_t>(clamped);
+    }
+
+    double
+    chunk_sum(size_t chunk) const
+    {
+        double sum = 0;
+        for(size_t i = chunk * _chunk_size; i < (chunk + 1) * _chunk_size; ++i)
+            sum += _data[i];
+        return sum;
+    }
+
+    min_max
+    chunk_extrema(size_t chunk) const
+    {
+        min_max extrema;
+        for(size_t i = chunk * _chunk_size; i < (chunk + 1) * _chunk_size; ++i)
+        {
+            extrema.min = std::min(extrema.min, _data[i]);
+            extrema.max = std::max(extrema.max, _data[i]);
+        }
+        return extrema;
+    }
+
+    std::vector<uint32_t>
+    chunk_histogram(size_t chunk) const
+    {
+        auto histogram = std::vector<uint32_t>(_bins);
+        for(size_t i = chunk * _chunk_size; i < (chunk + 1) * _chunk_size; ++i)
+            ++histogram[bin(_data[i])];
+        return histogram;
+    }
+
+    bool check_result() override
+    {
+        return _sum == _sum_answer
+            && _extrema.min == _extrema_answer.min
+            && _extrema.max == _extrema_answer.max
+            && _histogram == _histogram_answer;
+    }
+
+    void prepare() override
+    {
+        pool_bench::normal_generator rng(0);
+        for(auto& i : _data)
+            i = rng();
+
+        for(size_t c = 0; c < chunks(); ++c)
+        {
+            _sum_answer += chunk_sum(c);
+            _extrema_answer.combine(chunk_extrema(c));
+            auto histogram = chunk_histogram(c);
+            for(size_t b = 0; b < _bins; ++b)
+                _histogram_answer[b] += histogram[b];
+        }
+
+        if(_shared_partials)
+        {
+            _shared_sum.resize(chunks());
+            _shared_extrema.resize(chunks());
+            _shared_histogram.resize(chunks() * _bins);
+        }
+    }
+
+    void teardown() override {}
+
+    void
+    run_typed(pool_bench::executor& async)
+    {
+        auto sums = std::vector<pool_bench::future<double>>();
+        auto extrema = std::vector<pool_bench::future<min_max>>();
+        auto histograms = std::vector<pool_bench::future<std::vector<uint32_t>>>();
+        sums.reserve(chunks());
+        extrema.reserve(chunks());
+        histograms.reserve(chunks());
+
+        for(size_t c = 0; c < chunks(); ++c)
+        {
+            sums.emplace_back(async.submit([this, c]{ return chunk_sum(c); }));
+            extrema.emplace_back(async.submit([this, c]{ return chunk_extrema(c); }));
+            histograms.emplace_back(async.submit([this, c]{ return chunk_histogram(c); }));
+        }
+
+        for(auto& i : sums)
+            _sum += i.get();
+        for(auto& i : extrema)
+            _extrema.combine(i.get());
+        for(auto& i : histograms)
+        {
+            auto partial = i.get();
+            for(size_t b = 0; b < _bins; ++b)
+                _histogram[b] += partial[b];
+        }
+    }
+
+    void
+    run_shared(pool_bench::executor& async)
+    {
+        auto tasks = std::vector<std::future<void>>();
+        tasks.reserve(problem_size());
+
+        size_t stride = chunks();
+        for(size_t c = 0; c < chunks(); ++c)
+        {
+            tasks.emplace_back(async([this, c]{ _shared_sum[c] = chunk_sum(c); }));
+            tasks.emplace_back(async([this, c]{ _shared_extrema[c] = chunk_extrema(c); }));
+            tasks.emplace_back(async(
+                    [this, c, stride]
+                    {
+                        for(size_t b = 0; b < _bins; ++b)
+                            _shared_histogram[b * stride + c] = 0;
+                        for(size_t i = c * _chunk_size; i < (c + 1) * _chunk_size; ++i)
+                            ++_shared_histogram[bin(_data[i]) * stride + c];
+                    }));
+        }
+
+        for(auto& i : tasks)
+            i.get();
+
+        for(size_t c = 0; c < chunks(); ++c)
+        {
+            _sum += _shared_sum[c];
+            _extrema.combine(_shared_extrema[c]);
+        }
+        for(size_t b = 0; b < _bins; ++b)
+        {
+            for(size_t c = 0; c < chunks(); ++c)
+                _histogram[b] += _shared_histogram[b * stride + c];
+        }
+    }
+
+    void
+    run(pool_bench::executor&& async) override
+    {
+        _sum = 0;
+        _extrema = min_max();
+        std::fill(_histogram.begin(), _histogram.end(), 0);
+
+        if(_shared_partials)
+            run_shared(async);
+        else
+            run_typed(async);
+    }
+};
+
+struct shared_parallel_reduction : public parallel_reduction
+{
+    shared_parallel_reduction()
+        : parallel_reduction(true)
+    {}
+};
+
+REGISTER_BENCHMARK(parallel_reduction)
+REGISTER_BENCHMARK(shared_parallel_reduction)
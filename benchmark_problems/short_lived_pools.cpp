@@ -0,0 +1,177 @@
+
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018  Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <pool_bench.hpp>
+
+namespace chrono = std::chrono;
+
+/*
+ * A pool per request: every cycle constructs the runner's pool, runs a few
+ * hundred short tasks on it and destroys it again, the way tools that spin
+ * up a pool per request use them. The runner the harness prepared is torn
+ * down first and prepared again at the end, outside the cycles.
+ */
+struct short_lived_pools : public pool_bench::suite
+{
+    size_t _cycles;
+    size_t _task_count;
+    size_t _iterations;
+
+    std::vector<double> _results;
+    std::vector<double> _answer;
+
+    std::vector<chrono::nanoseconds> _construct;
+    std::vector<chrono::nanoseconds> _first_task;
+    std::vector<chrono::nanoseconds> _execute;
+    std::vector<chrono::nanoseconds> _shutdown;
+    chrono::nanoseconds _span;
+
+    short_lived_pools()
+        :_cycles(64),
+         _task_count(256),
+         _iterations(2000),
+         _results(_cycles * _task_count),
+         _answer(_cycles * _task_count),
+         _construct(_cycles),
+         _first_task(_cycles),
+         _execute(_cycles),
+         _shutdown(_cycles),
+         _span(0)
+    {}
+
+    size_t
+    problem_size() override
+    {
+        return _cycles * _task_count;
+    }
+
+    char const*
+    name() override
+    {
+        return "short lived pools";
+    }
+
+    bool check_result() override
+    {
+        return _results == _answer;
+    }
+
+    void prepare() override
+    {
+        for(size_t i = 0; i < _answer.size(); ++i)
+            _answer[i] = pool_bench::spin_work(i, _iterations);
+    }
+
+    void teardown() override {}
+
+    bool shares_pool() override
+    {
+        return false;
+    }
+
+    void
+    run(pool_bench::executor&& async) override
+    {
+        auto pool = async.pool();
+        if(!pool)
+            throw std::runtime_error("Error: \"short lived pools\" needs the runner to rebuild its pool");
+
+        std::fill(_results.begin(), _results.end(), 0.0);
+        auto tasks = std::vector<std::future<void>>();
+        tasks.reserve(_task_count);
+
+        auto span_start = chrono::steady_clock::now();
+        pool->teardown();
+        for(size_t cycle = 0; cycle < _cycles; ++cycle)
+        {
+            auto construct_start = chrono::steady_clock::now();
+            pool->prepare();
+            auto submit = (*pool)();
+            auto construct_stop = chrono::steady_clock::now();
+
+            /* Written by the first task, read after the join below */
+            auto first_start = construct_stop;
+            for(size_t i = 0; i < _task_count; ++i)
+            {
+                auto index = cycle * _task_count + i;
+                tasks.emplace_back(submit(
+                        [this, index, i, &first_start]
+                        {
+                            if(i == 0)
+                                first_start = chrono::steady_clock::now();
+                            _results[index] = pool_bench::spin_work(index, _iterations);
+                        }));
+            }
+            for(auto& i : tasks)
+                i.get();
+            tasks.clear();
+            auto execute_stop = chrono::steady_clock::now();
+
+            pool->teardown();
+            auto shutdown_stop = chrono::steady_clock::now();
+
+            _construct[cycle] = construct_stop - construct_start;
+            _first_task[cycle] = first_start - construct_stop;
+            _execute[cycle] = execute_stop - construct_stop;
+            _shutdown[cycle] = shutdown_stop - execute_stop;
+        }
+        _span = chrono::steady_clock::now() - span_start;
+        pool->prepare();
+    }
+
+    /*
+     * construct:  runner::prepare() and fetching its submission function
+     * first task: from the end of construction until the first task starts
+     * execute:    submitting and joining the cycle's tasks
+     * shutdown:   runner::teardown()
+     * all as means per pool, plus whole pool lifetimes per second
+     */
+    std::string report() override
+    {
+        using float_millisec = chrono::duration<double, std::milli>;
+        auto mean = [this](std::vector<chrono::nanoseconds> const& samples)
+                    {
+                        chrono::nanoseconds total(0);
+                        for(auto& i : samples)
+                            total += i;
+                        return chrono::duration_cast<float_millisec>(total).count() / _cycles;
+                    };
+
+        double span = chrono::duration_cast<chrono::duration<double>>(_span).count();
+        char buffer[256];
+        snprintf(buffer, sizeof(buffer),
+                 "    construct %.3fms, first task %.3fms, execute %.3fms, shutdown %.3fms, %.1f pools/s",
+                 mean(_construct),
+                 mean(_first_task),
+                 mean(_execute),
+                 mean(_shutdown),
+                 _cycles / span);
+        return buffer;
+    }
+};
+
+REGISTER_BENCHMARK(short_lived_pools)
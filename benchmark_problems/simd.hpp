@@ -0,0 +1,69 @@
+
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018  Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _POOL_BENCH_SIMD_HPP_
+#define _POOL_BENCH_SIMD_HPP_
+
+/*
+ * Vector kernels are compiled per function with target attributes and
+ * picked at runtime, so the binary still runs on machines without AVX.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define POOL_BENCH_X86_SIMD 1
+#include <immintrin.h>
+#define POOL_BENCH_TARGET(ISA) __attribute__((target(ISA)))
+#else
+#define POOL_BENCH_X86_SIMD 0
+#endif
+
+namespace simd
+{
+    enum class isa
+    {
+        scalar,
+        avx2,
+        avx512
+    };
+
+    inline isa
+    detect_isa()
+    {
+#if POOL_BENCH_X86_SIMD
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f"))
+            return isa::avx512;
+        if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return isa::avx2;
+#endif
+        return isa::scalar;
+    }
+
+    inline char const*
+    isa_name(isa set)
+    {
+        switch(set)
+        {
+        case isa::avx512: return "avx512";
+        case isa::avx2:   return "avx2";
+        default:          return "scalar";
+        }
+    }
+}
+
+#endif
@@ -20,13 +20,28 @@
 #ifndef _POOL_BENCH_POOL_BENCH_
 #define _POOL_BENCH_POOL_BENCH_
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <future>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "pool_bench_function.hpp"
+
 namespace pool_bench
 {
     namespace chrono = std::chrono;
@@ -34,6 +49,143 @@ namespace pool_bench
     struct runner;
     struct suite;
 
+    using task_function = pool_bench::unique_function<void(void)>;
+    using async_function = std::function<std::future<void>(task_function&&)>;
+
+    /* Scheduling class of a submitted task; pools without priorities run them all alike */
+    enum class priority
+    {
+        low,
+        normal,
+        high
+    };
+
+    constexpr size_t priority_levels = 3;
+
+    using prioritized_function = std::function<std::future<void>(task_function&&, priority)>;
+    using post_function = std::function<void(task_function&&)>;
+    using packaged_function = std::function<void(task_function&&, priority)>;
+
+    /* Body of a parallel loop, called on half-open chunks [begin, end) */
+    using range_function = std::function<void(size_t, size_t)>;
+    using for_function = std::function<void(size_t, size_t, size_t, range_function const&)>;
+
+    /*
+     * Loop over [begin, end) as one submitted task per chunk of grain
+     * indices, the way suites split their loops by hand. Waits for every
+     * chunk before rethrowing the first exception, as they all use body.
+     */
+    template<typename Submit>
+    inline void
+    chunked_for(Submit&& submit, size_t begin, size_t end, size_t grain,
+                range_function const& body)
+    {
+        grain = std::max<size_t>(grain, 1);
+        auto tasks = std::vector<std::future<void>>();
+        tasks.reserve((end - std::min(begin, end) + grain - 1) / grain);
+        for(size_t i = begin; i < end; i += grain)
+        {
+            auto last = std::min(i + grain, end);
+            tasks.emplace_back(submit([&body, i, last]{ body(i, last); }));
+        }
+        for(auto& i : tasks)
+            i.wait();
+        for(auto& i : tasks)
+            i.get();
+    }
+
+    /*
+     * Loop for pools that queue plain tasks: up to helpers posted tasks
+     * and the calling thread take grain sized chunks off a shared cursor
+     * until none are left, so a loop costs a task per thread rather than
+     * per chunk. The caller works too, so the loop finishes even when no
+     * helper gets a worker. Returns once every helper has, rethrowing the
+     * first exception of body; chunks not yet taken are then skipped.
+     */
+    template<typename Post>
+    inline void
+    shared_range_for(Post&& post, unsigned helpers, size_t begin, size_t end, size_t grain,
+                     range_function const& body)
+    {
+        if(begin >= end)
+            return;
+        grain = std::max<size_t>(grain, 1);
+        auto chunks = (end - begin + grain - 1) / grain;
+
+        struct loop_state
+        {
+            std::atomic<size_t> next;
+            std::mutex lock;
+            std::condition_variable finished;
+            size_t running;
+            std::exception_ptr error;
+        } state;
+        state.next = begin;
+        state.running = static_cast<size_t>(std::min<size_t>(helpers, chunks - 1));
+
+        auto work = [&state, &body, end, grain]
+                    {
+                        try
+                        {
+                            for(auto first = state.next.fetch_add(grain, std::memory_order_relaxed);
+                                first < end;
+                                first = state.next.fetch_add(grain, std::memory_order_relaxed))
+                                body(first, std::min(first + grain, end));
+                        }
+                        catch(...)
+                        {
+                            state.next.store(end, std::memory_order_relaxed);
+                            std::lock_guard<std::mutex> guard(state.lock);
+                            if(!state.error)
+                                state.error = std::current_exception();
+                        }
+                    };
+
+        for(size_t i = state.running; i != 0; --i)
+        {
+            post([&state, &work]
+                 {
+                     work();
+                     std::lock_guard<std::mutex> guard(state.lock);
+                     if(--state.running == 0)
+                         state.finished.notify_all();
+                 });
+        }
+        work();
+
+        std::unique_lock<std::mutex> lock(state.lock);
+        state.finished.wait(lock, [&state]{ return state.running == 0; });
+        if(state.error)
+            std::rethrow_exception(state.error);
+    }
+
+    /*
+     * Whether the task running on this thread was taken from another
+     * worker's queue: 1 or 0 in pools that set it before each task, -1 in
+     * those that cannot tell.
+     */
+    inline int&
+    running_stolen()
+    {
+        static thread_local int stolen = -1;
+        return stolen;
+    }
+
+    /* Set by --workers; 0 leaves every pool at its own default */
+    inline unsigned&
+    worker_override()
+    {
+        static unsigned workers = 0;
+        return workers;
+    }
+
+    /* The number of workers a pool should start */
+    inline unsigned
+    worker_count(unsigned fallback = std::thread::hardware_concurrency())
+    {
+        return worker_override() ? worker_override() : fallback;
+    }
+
     inline std::vector<pool_bench::suite*>&
     get_suites()
     {
@@ -48,6 +200,77 @@ namespace pool_bench
         return runners;
     }
 
+    /*
+     * executed:      tasks the worker ran
+     * steals:        tasks it took from another worker's queue
+     * failed_steals: visits to another worker's queue that came back empty
+     * blocked:       time spent waiting for work on its queue
+     * peak_depth:    most tasks its queue held at once
+     */
+    struct worker_stats
+    {
+        size_t executed;
+        size_t steals;
+        size_t failed_steals;
+        chrono::nanoseconds blocked;
+        size_t peak_depth;
+    };
+
+    /*
+     * Scheduler counters of a pool since runner::prepare().
+     * failed_try_push: non-blocking pushes that found a queue busy
+     * push_fallbacks:  submissions that gave up on try_push and blocked
+     */
+    struct scheduler_stats
+    {
+        std::vector<worker_stats> workers;
+        size_t failed_try_push = 0;
+        size_t push_fallbacks = 0;
+    };
+
+    /*
+     * Counters kept by an instrumented pool for one of its workers.
+     * Only the worker itself writes them, so increments are relaxed
+     * load/store pairs rather than read-modify-writes; the padding keeps
+     * neighbouring workers' counters off each other's cache lines.
+     * reset() is the exception, called between runs while the pool idles.
+     */
+    struct worker_counters
+    {
+        std::atomic<size_t> executed{0};
+        std::atomic<size_t> steals{0};
+        std::atomic<size_t> failed_steals{0};
+        std::atomic<chrono::nanoseconds::rep> blocked{0};
+        char padding[64];
+
+        template<typename T>
+        static inline void
+        bump(std::atomic<T>& counter, T amount = 1)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + amount,
+                          std::memory_order_relaxed);
+        }
+
+        inline void
+        reset()
+        {
+            executed.store(0, std::memory_order_relaxed);
+            steals.store(0, std::memory_order_relaxed);
+            failed_steals.store(0, std::memory_order_relaxed);
+            blocked.store(0, std::memory_order_relaxed);
+        }
+
+        inline worker_stats
+        snapshot(size_t peak_depth) const
+        {
+            return {executed.load(std::memory_order_relaxed),
+                    steals.load(std::memory_order_relaxed),
+                    failed_steals.load(std::memory_order_relaxed),
+                    chrono::nanoseconds(blocked.load(std::memory_order_relaxed)),
+                    peak_depth};
+        }
+    };
+
     struct runner
     {
         inline runner()
@@ -59,10 +282,670 @@ namespace pool_bench
         virtual void prepare() = 0;
         virtual void teardown() = 0;
 
-        virtual std::function<std::future<void>(std::function<void(void)>&&)>
+        virtual async_function
         operator()() = 0;
+
+        /* Submission at the given priority, mapped to the pool's native
+         * priorities where it has them; normal must behave like operator()() */
+        virtual async_function
+        at_priority(pool_bench::priority)
+        {
+            return (*this)();
+        }
+
+        /* Pools that keep scheduler counters report them here; no workers otherwise */
+        virtual scheduler_stats stats() { return {}; }
+
+        /* Zeroes those counters and peak depths; the harness calls it with
+         * the pool idle, right before the run it reports on */
+        virtual void reset_stats() {}
+
+        /* Whether the pool starts worker_count() workers, so --workers reaches it */
+        virtual bool takes_worker_count() { return false; }
+
+        /* Threads the pool runs at the moment, or -1 where it cannot tell */
+        virtual long threads() { return -1; }
+
+        /*
+         * Runs a task that settles its own future: the std::packaged_task<T()>
+         * executor::submit made for a typed result, whose future the suite
+         * holds. The default queues it through the void path and drops that
+         * path's future; pools that queue packaged tasks of any type natively
+         * override it to queue this one in place of their own.
+         */
+        virtual void
+        submit_packaged(task_function&& f, pool_bench::priority level)
+        {
+            at_priority(level)(std::move(f));
+        }
+
+        /* Drops the tasks queued but not yet started, breaking their futures,
+         * and returns how many; pools that cannot reach their queues drop none */
+        virtual size_t cancel_pending() { return 0; }
+
+        /*
+         * Submits a task nobody waits on through a future, as chained tasks
+         * signal their own completion. Often called from a worker releasing
+         * a continuation; pools override it to skip the future or to keep
+         * the continuation on that worker. The default drops the future.
+         */
+        virtual void
+        post(task_function&& f)
+        {
+            (*this)()(std::move(f));
+        }
+
+        /*
+         * Calls body on chunks covering [begin, end) and returns once all
+         * are done. grain is the chunk size, or the smallest a pool that
+         * partitions by itself may split down to. Pools override it with
+         * their own loop; the default submits a task per chunk.
+         */
+        virtual void
+        parallel_for(size_t begin, size_t end, size_t grain, range_function const& body)
+        {
+            chunked_for((*this)(), begin, end, grain, body);
+        }
     };
 
+    /*
+     * Cooperative cancellation shared by a batch of tasks, which check it
+     * when they start and return early once it is set. Copies share the flag.
+     */
+    class cancellation_token
+    {
+        std::shared_ptr<std::atomic<bool>> _cancelled;
+
+    public:
+        inline
+        cancellation_token()
+            : _cancelled(std::make_shared<std::atomic<bool>>(false))
+        {}
+
+        inline void
+        cancel()
+        {
+            _cancelled->store(true, std::memory_order_relaxed);
+        }
+
+        inline bool
+        cancelled() const
+        {
+            return _cancelled->load(std::memory_order_relaxed);
+        }
+    };
+
+    namespace internal
+    {
+        /* Storage for a task's return value, filled in on the worker */
+        template<typename T>
+        class result_slot
+        {
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type _storage;
+            bool _ready = false;
+
+        public:
+            inline ~result_slot()
+            {
+                if(_ready)
+                    value().~T();
+            }
+
+            template<typename F>
+            inline void
+            emplace(F& f)
+            {
+                new (&_storage) T(f());
+                _ready = true;
+            }
+
+            inline T&
+            value()
+            {
+                return *reinterpret_cast<T*>(&_storage);
+            }
+        };
+
+        template<>
+        class result_slot<void>
+        {
+        public:
+            template<typename F>
+            inline void
+            emplace(F& f)
+            {
+                f();
+            }
+
+            inline void
+            value()
+            {}
+        };
+
+        /*
+         * Completion of a chained task: its result or exception, and the
+         * continuations waiting for it. Those run on the thread that
+         * completes the task, or at once when registered after it.
+         */
+        template<typename T>
+        class chain_state
+        {
+            std::mutex _lock;
+            std::condition_variable _ready_signal;
+            bool _settled = false;
+            bool _ready = false;
+            std::vector<task_function> _waiting;
+            result_slot<T> _value;
+            std::exception_ptr _error;
+
+        public:
+            template<typename F>
+            inline void
+            run(F& f)
+            {
+                try
+                {
+                    _value.emplace(f);
+                }
+                catch(...)
+                {
+                    _error = std::current_exception();
+                }
+                finish();
+            }
+
+            /* Keeps the first error of several, for when_all */
+            inline void
+            note_error(std::exception_ptr error)
+            {
+                std::lock_guard<std::mutex> guard(_lock);
+                if(!_error)
+                    _error = error;
+            }
+
+            /* Continuations run, and so post their tasks, before waiters
+             * wake, so a chain has made every post by the time its result
+             * is seen; ones registered meanwhile run on their caller */
+            inline void
+            finish()
+            {
+                std::vector<task_function> waiting;
+                {
+                    std::lock_guard<std::mutex> guard(_lock);
+                    _settled = true;
+                    waiting.swap(_waiting);
+                }
+                for(auto& i : waiting)
+                    i();
+                {
+                    std::lock_guard<std::mutex> guard(_lock);
+                    _ready = true;
+                }
+                _ready_signal.notify_all();
+            }
+
+            inline void
+            on_ready(task_function&& f)
+            {
+                {
+                    std::lock_guard<std::mutex> guard(_lock);
+                    if(!_settled)
+                    {
+                        _waiting.emplace_back(std::move(f));
+                        return;
+                    }
+                }
+                f();
+            }
+
+            inline void
+            wait()
+            {
+                std::unique_lock<std::mutex> lock(_lock);
+                _ready_signal.wait(lock, [this]{ return _ready; });
+            }
+
+            /* Only once ready */
+            inline std::exception_ptr
+            error() const
+            {
+                return _error;
+            }
+
+            /* Only once ready; rethrows the task's exception */
+            inline decltype(auto)
+            value()
+            {
+                if(_error)
+                    std::rethrow_exception(_error);
+                return _value.value();
+            }
+        };
+
+        template<typename T, typename F>
+        inline decltype(auto)
+        call_with(chain_state<T>& source, F& f)
+        {
+            return f(source.value());
+        }
+
+        template<typename F>
+        inline decltype(auto)
+        call_with(chain_state<void>& source, F& f)
+        {
+            source.value();
+            return f();
+        }
+
+        template<typename T, typename F>
+        using continuation_result_t = std::decay_t<decltype(
+            call_with(std::declval<chain_state<T>&>(), std::declval<std::decay_t<F>&>()))>;
+    }
+
+    class executor;
+
+    /*
+     * Result of a task started with executor::spawn() or then(), which
+     * further tasks can be chained onto without blocking a thread.
+     * Copies share the result; get() waits and returns a reference to it.
+     */
+    template<typename T>
+    class continuable
+    {
+        std::shared_ptr<internal::chain_state<T>> _state;
+
+        friend class executor;
+
+        template<typename U>
+        friend continuable<void> when_all(std::vector<continuable<U>> const& tasks);
+
+    public:
+        continuable() = default;
+
+        inline explicit
+        continuable(std::shared_ptr<internal::chain_state<T>> state)
+            : _state(std::move(state))
+        {}
+
+        inline bool
+        valid() const
+        {
+            return static_cast<bool>(_state);
+        }
+
+        inline void
+        wait() const
+        {
+            _state->wait();
+        }
+
+        inline decltype(auto)
+        get() const
+        {
+            _state->wait();
+            return _state->value();
+        }
+    };
+
+    /* Ready when all of the tasks are, failing with the first error among them */
+    template<typename T>
+    inline continuable<void>
+    when_all(std::vector<continuable<T>> const& tasks)
+    {
+        auto state = std::make_shared<internal::chain_state<void>>();
+        if(tasks.empty())
+        {
+            state->finish();
+            return continuable<void>(std::move(state));
+        }
+
+        auto remaining = std::make_shared<std::atomic<size_t>>(tasks.size());
+        for(auto& i : tasks)
+        {
+            auto source = i._state;
+            source->on_ready([state, remaining, source]
+                             {
+                                 if(source->error())
+                                     state->note_error(source->error());
+                                 if(remaining->fetch_sub(1, std::memory_order_acq_rel) == 1)
+                                     state->finish();
+                             });
+        }
+        return continuable<void>(std::move(state));
+    }
+
+    /*
+     * Future of a typed task submitted through an executor: the future of
+     * the std::packaged_task<T()> the runner was handed, so value,
+     * completion and exception share the one state the task settles.
+     */
+    template<typename T>
+    class future
+    {
+        std::future<T> _value;
+
+    public:
+        future() = default;
+
+        inline explicit
+        future(std::future<T>&& value)
+            : _value(std::move(value))
+        {}
+
+        inline bool
+        valid() const
+        {
+            return _value.valid();
+        }
+
+        inline void
+        wait() const
+        {
+            _value.wait();
+        }
+
+        inline T
+        get()
+        {
+            return _value.get();
+        }
+    };
+
+    /*
+     * What suites submit work through.
+     * Wraps the runner's submission function, and hands typed tasks to the
+     * runner packaged with their result, see runner::submit_packaged.
+     */
+    class executor
+    {
+        prioritized_function _async;
+        pool_bench::runner* _pool;
+        /* Shared with queued continuations, which may hold it after run()
+         * returns but must not post then, as the harness's post_call refers
+         * to execute_benchmark's locals; suites wait on every chain's end */
+        std::shared_ptr<post_function> _post;
+        for_function _parallel_for;
+        packaged_function _packaged;
+
+    public:
+        inline explicit
+        executor(prioritized_function&& async,
+                 pool_bench::runner* pool = nullptr,
+                 post_function&& post = nullptr,
+                 for_function&& parallel_for = nullptr,
+                 packaged_function&& packaged = nullptr)
+            : _async(std::move(async)),
+              _pool(pool),
+              _post(std::make_shared<post_function>(std::move(post))),
+              _parallel_for(std::move(parallel_for)),
+              _packaged(std::move(packaged))
+        {
+            if(!_packaged && _pool)
+                _packaged = [pool](task_function&& f, priority level)
+                            { pool->submit_packaged(std::move(f), level); };
+            if(!_packaged)
+                _packaged = [async = _async](task_function&& f, priority level)
+                            { async(std::move(f), level); };
+            if(!*_post)
+                *_post = [async = _async](task_function&& f)
+                         { async(std::move(f), priority::normal); };
+            if(!_parallel_for)
+                _parallel_for = [async = _async](size_t begin, size_t end, size_t grain,
+                                                 range_function const& body)
+                                {
+                                    auto submit = [&async](task_function&& f)
+                                                  { return async(std::move(f), priority::normal); };
+                                    chunked_for(submit, begin, end, grain, body);
+                                };
+        }
+
+        inline explicit
+        executor(async_function&& async, pool_bench::runner* pool = nullptr)
+            : executor(prioritized_function([async = std::move(async)](task_function&& f, priority)
+                                            { return async(std::move(f)); }),
+                       pool)
+        {}
+
+        inline std::future<void>
+        operator()(task_function&& f, priority level = priority::normal)
+        {
+            return _async(std::move(f), level);
+        }
+
+        /*
+         * The runner behind this executor, for suites that measure the
+         * pool's own lifecycle. A suite that tears the runner down must
+         * leave it prepared again when run() returns.
+         */
+        inline pool_bench::runner*
+        pool() const
+        {
+            return _pool;
+        }
+
+        template<typename F,
+                 typename R = std::result_of_t<std::decay_t<F>()>,
+                 typename = std::enable_if_t<!std::is_void<R>::value>>
+        inline pool_bench::future<R>
+        submit(F&& f, priority level = priority::normal)
+        {
+            auto task = std::packaged_task<R()>(std::forward<F>(f));
+            auto result = task.get_future();
+            _packaged([task = std::move(task)]() mutable
+                      { task(); },
+                      level);
+            return pool_bench::future<R>(std::move(result));
+        }
+
+        /* Runs body over [begin, end) with the pool's own loop; see runner::parallel_for */
+        template<typename F>
+        inline void
+        parallel_for(size_t begin, size_t end, size_t grain, F&& body)
+        {
+            _parallel_for(begin, end, grain, range_function(std::forward<F>(body)));
+        }
+
+        /* Starts a chain; the task is posted, not waited on through a future */
+        template<typename F,
+                 typename R = std::result_of_t<std::decay_t<F>()>>
+        inline continuable<R>
+        spawn(F&& f)
+        {
+            auto state = std::make_shared<internal::chain_state<R>>();
+            (*_post)([state, f = std::forward<F>(f)]() mutable
+                     { state->run(f); });
+            return continuable<R>(std::move(state));
+        }
+
+        /*
+         * Runs f with the antecedent's result once it is ready, posted by
+         * the thread that completes the antecedent. An exception of the
+         * antecedent skips f and carries on down the chain.
+         */
+        template<typename T,
+                 typename F,
+                 typename R = internal::continuation_result_t<T, F>>
+        inline continuable<R>
+        then(continuable<T> const& antecedent, F&& f)
+        {
+            auto state = std::make_shared<internal::chain_state<R>>();
+            auto source = antecedent._state;
+            source->on_ready([post = _post, state, source, f = std::forward<F>(f)]() mutable
+                             {
+                                 (*post)([state, source, f = std::move(f)]() mutable
+                                         {
+                                             auto call = [&]() -> decltype(auto)
+                                                         { return internal::call_with(*source, f); };
+                                             state->run(call);
+                                         });
+                             });
+            return continuable<R>(std::move(state));
+        }
+    };
+
+    /*
+     * Time spent in one named phase of a suite's run.
+     * wall:    harness thread time inside the phase
+     * barrier: part of wall spent waiting for the phase's tasks
+     * busy:    execution time of the tasks submitted in the phase, summed
+     *          over all workers
+     * The run's tracer, if any, interns the name once into trace_label.
+     */
+    struct phase_timing
+    {
+        std::string name;
+        size_t entries;
+        chrono::nanoseconds wall;
+        chrono::nanoseconds barrier;
+        std::atomic<chrono::nanoseconds::rep> busy;
+        std::atomic<char const*> trace_label;
+
+        inline explicit
+        phase_timing(std::string phase_name)
+            : name(std::move(phase_name)),
+              entries(0),
+              wall(0),
+              barrier(0),
+              busy(0),
+              trace_label(nullptr)
+        {}
+    };
+
+    /*
+     * Only the harness thread enters and leaves phases, but tasks submitted
+     * from the workers read the active one too, hence the atomic.
+     */
+    class phase_recorder
+    {
+        std::deque<phase_timing> _phases;
+        std::atomic<phase_timing*> _active{nullptr};
+
+    public:
+        inline phase_timing*
+        enter(char const* name)
+        {
+            auto previous = _active.load();
+            auto found = std::find_if(_phases.begin(), _phases.end(),
+                                      [name](phase_timing const& p)
+                                      { return p.name == name; });
+            phase_timing* next;
+            if(found == _phases.end())
+            {
+                _phases.emplace_back(name);
+                next = &_phases.back();
+            }
+            else
+                next = &*found;
+            ++next->entries;
+            _active = next;
+            return previous;
+        }
+
+        inline void
+        leave(phase_timing* previous)
+        {
+            _active = previous;
+        }
+
+        inline phase_timing*
+        active() const
+        {
+            return _active.load();
+        }
+
+        inline std::deque<phase_timing> const&
+        phases() const
+        {
+            return _phases;
+        }
+
+        /* The recorder of the benchmark running on this thread, if any */
+        static inline phase_recorder*&
+        current()
+        {
+            static thread_local phase_recorder* recorder = nullptr;
+            return recorder;
+        }
+    };
+
+    /*
+     * Marks the enclosing scope of a suite's run as a named phase.
+     * Entering the same name again accumulates into the same entry.
+     */
+    class phase
+    {
+        phase_recorder* _recorder;
+        phase_timing* _previous;
+        chrono::steady_clock::time_point _start;
+
+    public:
+        inline explicit
+        phase(char const* name)
+            : _recorder(phase_recorder::current()),
+              _previous(_recorder ? _recorder->enter(name) : nullptr),
+              _start(chrono::steady_clock::now())
+        {}
+
+        phase(phase const&) = delete;
+        phase& operator=(phase const&) = delete;
+
+        inline ~phase()
+        {
+            if(!_recorder)
+                return;
+            _recorder->active()->wall += chrono::steady_clock::now() - _start;
+            _recorder->leave(_previous);
+        }
+    };
+
+    /* Attributes the enclosing scope to the active phase's barrier time */
+    class barrier
+    {
+        phase_timing* _phase;
+        chrono::steady_clock::time_point _start;
+
+    public:
+        inline
+        barrier()
+            : _phase(phase_recorder::current()
+                     ? phase_recorder::current()->active() : nullptr),
+              _start(chrono::steady_clock::now())
+        {}
+
+        barrier(barrier const&) = delete;
+        barrier& operator=(barrier const&) = delete;
+
+        inline ~barrier()
+        {
+            if(_phase)
+                _phase->barrier += chrono::steady_clock::now() - _start;
+        }
+    };
+
+    /*
+     * Floating point work proportional to iterations, a few nanoseconds
+     * each, and deterministic for a given seed so suites can precompute
+     * the answer. Stands in for the CPU part of a task.
+     */
+    inline double
+    spin_work(size_t seed, size_t iterations)
+    {
+        double x = static_cast<double>(seed) + 2.0;
+        for(size_t i = 0; i < iterations; ++i)
+            x = std::sqrt(x + 1.0 / (1.0 + i));
+        return x;
+    }
+
+    /* Waits for every task, counting the wait as barrier time */
+    template<typename Future>
+    inline void
+    join(std::vector<Future>& tasks)
+    {
+        pool_bench::barrier scope;
+        for(auto& i : tasks)
+            i.get();
+    }
+
     struct suite
     {
         inline suite()
@@ -71,12 +954,22 @@ namespace pool_bench
         }
 
         virtual size_t problem_size() = 0;
-        virtual void run(
-            std::function<std::future<void>(std::function<void(void)>&&)>&& f) = 0;
+        virtual void run(pool_bench::executor&& async) = 0;
         virtual char const* name () = 0;
         virtual bool check_result () = 0;
         virtual void prepare () = 0;
         virtual void teardown() = 0;
+
+        /* Restores the input state before every run, outside the timed region */
+        virtual void reset() {}
+
+        /* Extra measurements of the last run, printed under the runner's row */
+        virtual std::string report() { return {}; }
+
+        /* False for suites that rebuild or drain the runner themselves and
+         * so cannot run beside other suites on one pool */
+        virtual bool shares_pool() { return true; }
+
         virtual ~suite() = default;
     };
 }
@@ -0,0 +1,154 @@
+
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018 Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _POOL_BENCH_CLOCK_HPP_
+#define _POOL_BENCH_CLOCK_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define POOL_BENCH_TSC 1
+#include <cpuid.h>
+#include <x86intrin.h>
+#else
+#define POOL_BENCH_TSC 0
+#endif
+
+namespace pool_bench
+{
+    namespace chrono = std::chrono;
+
+    /*
+     * Timestamps for intervals too short for steady_clock::now() to measure
+     * without dominating them. On x86-64 with an invariant TSC these are
+     * fenced rdtsc readings, converted with a rate calibrated once against
+     * steady_clock; elsewhere they are steady_clock nanoseconds.
+     * overhead is the median of an empty measurement, in ticks, to be
+     * subtracted from every measured interval.
+     */
+    class tick_clock
+    {
+        bool _tsc;
+        double _ns_per_tick;
+        uint64_t _overhead;
+
+        static inline bool
+        invariant_tsc()
+        {
+#if POOL_BENCH_TSC
+            unsigned eax, ebx, ecx, edx;
+            if(!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+                return false;
+            __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+            return (edx >> 8) & 1;
+#else
+            return false;
+#endif
+        }
+
+        inline
+        tick_clock()
+            : _tsc(invariant_tsc()),
+              _ns_per_tick(1.0),
+              _overhead(0)
+        {
+            if(_tsc)
+            {
+                auto start = chrono::steady_clock::now();
+                auto start_ticks = now();
+                auto stop = start;
+                while(stop - start < chrono::milliseconds(20))
+                    stop = chrono::steady_clock::now();
+                auto stop_ticks = now();
+                _ns_per_tick = chrono::duration<double, std::nano>(stop - start).count()
+                    / static_cast<double>(stop_ticks - start_ticks);
+            }
+
+            auto empty = std::vector<uint64_t>(1001);
+            for(auto& i : empty)
+            {
+                auto begin = now();
+                i = now() - begin;
+            }
+            std::nth_element(empty.begin(), empty.begin() + empty.size() / 2, empty.end());
+            _overhead = empty[empty.size() / 2];
+        }
+
+    public:
+        /* Calibrated on first use */
+        static inline tick_clock const&
+        get()
+        {
+            static tick_clock clock;
+            return clock;
+        }
+
+        inline uint64_t
+        now() const
+        {
+#if POOL_BENCH_TSC
+            if(_tsc)
+            {
+                _mm_lfence();
+                auto ticks = __rdtsc();
+                _mm_lfence();
+                return ticks;
+            }
+#endif
+            return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+                chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        inline bool
+        is_tsc() const
+        {
+            return _tsc;
+        }
+
+        inline double
+        ns_per_tick() const
+        {
+            return _ns_per_tick;
+        }
+
+        inline uint64_t
+        overhead() const
+        {
+            return _overhead;
+        }
+
+        /* A measured interval with the measurement overhead taken out */
+        inline uint64_t
+        corrected(uint64_t ticks) const
+        {
+            return ticks > _overhead ? ticks - _overhead : 0;
+        }
+
+        inline chrono::nanoseconds
+        to_duration(double ticks) const
+        {
+            return chrono::nanoseconds(static_cast<chrono::nanoseconds::rep>(ticks * _ns_per_tick));
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,246 @@
+
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018 Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _POOL_BENCH_FUNCTION_HPP_
+#define _POOL_BENCH_FUNCTION_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace pool_bench
+{
+    template<typename Signature>
+    class unique_function;
+
+    /*
+     * Move-only type-erased callable, like C++23's std::move_only_function,
+     * so tasks can own std::unique_ptr buffers and packaged_tasks.
+     * Callables of up to three pointers that move without throwing are
+     * stored inline, larger ones on the heap. As with std::function,
+     * calling through a const object calls the target as non-const.
+     */
+    template<typename R, typename... Args>
+    class unique_function<R(Args...)>
+    {
+        using storage = std::aligned_storage_t<3 * sizeof(void*), alignof(void*)>;
+
+        struct operations
+        {
+            R (*invoke)(storage&, Args&&...);
+            void (*move)(storage& to, storage& from) noexcept;
+            void (*destroy)(storage&) noexcept;
+        };
+
+        template<typename F>
+        static constexpr bool
+        is_inline()
+        {
+            return sizeof(F) <= sizeof(storage)
+                && alignof(storage) % alignof(F) == 0
+                && std::is_nothrow_move_constructible<F>::value;
+        }
+
+        template<typename F, bool Inline = is_inline<F>()>
+        struct model;
+
+        template<typename F>
+        struct model<F, true>
+        {
+            static inline F&
+            target(storage& s)
+            {
+                return *reinterpret_cast<F*>(&s);
+            }
+
+            static inline R
+            invoke(storage& s, Args&&... args)
+            {
+                return static_cast<R>(target(s)(std::forward<Args>(args)...));
+            }
+
+            static inline void
+            move(storage& to, storage& from) noexcept
+            {
+                new (&to) F(std::move(target(from)));
+                target(from).~F();
+            }
+
+            static inline void
+            destroy(storage& s) noexcept
+            {
+                target(s).~F();
+            }
+
+            template<typename G>
+            static inline void
+            create(storage& s, G&& f)
+            {
+                new (&s) F(std::forward<G>(f));
+            }
+
+            static inline operations const*
+            table()
+            {
+                static constexpr operations ops{&invoke, &move, &destroy};
+                return &ops;
+            }
+        };
+
+        template<typename F>
+        struct model<F, false>
+        {
+            static inline F*&
+            target(storage& s)
+            {
+                return *reinterpret_cast<F**>(&s);
+            }
+
+            static inline R
+            invoke(storage& s, Args&&... args)
+            {
+                return static_cast<R>((*target(s))(std::forward<Args>(args)...));
+            }
+
+            static inline void
+            move(storage& to, storage& from) noexcept
+            {
+                new (&to) F*(target(from));
+            }
+
+            static inline void
+            destroy(storage& s) noexcept
+            {
+                delete target(s);
+            }
+
+            template<typename G>
+            static inline void
+            create(storage& s, G&& f)
+            {
+                new (&s) F*(new F(std::forward<G>(f)));
+            }
+
+            static inline operations const*
+            table()
+            {
+                static constexpr operations ops{&invoke, &move, &destroy};
+                return &ops;
+            }
+        };
+
+        mutable storage _storage;
+        operations const* _operations;
+
+    public:
+        inline
+        unique_function() noexcept
+            : _operations(nullptr)
+        {}
+
+        inline
+        unique_function(std::nullptr_t) noexcept
+            : _operations(nullptr)
+        {}
+
+        template<typename F,
+                 typename D = std::decay_t<F>,
+                 typename = std::enable_if_t<!std::is_same<D, unique_function>::value>,
+                 typename = std::enable_if_t<std::is_convertible<
+                     std::result_of_t<D&(Args...)>, R>::value || std::is_void<R>::value>>
+        inline
+        unique_function(F&& f)
+            : _operations(model<D>::table())
+        {
+            model<D>::create(_storage, std::forward<F>(f));
+        }
+
+        inline
+        unique_function(unique_function&& other) noexcept
+            : _operations(other._operations)
+        {
+            if(_operations)
+            {
+                _operations->move(_storage, other._storage);
+                other._operations = nullptr;
+            }
+        }
+
+        inline unique_function&
+        operator=(unique_function&& other) noexcept
+        {
+            if(this != &other)
+            {
+                reset();
+                if(other._operations)
+                {
+                    other._operations->move(_storage, other._storage);
+                    _operations = other._operations;
+                    other._operations = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        inline unique_function&
+        operator=(std::nullptr_t) noexcept
+        {
+            reset();
+            return *this;
+        }
+
+        unique_function(unique_function const&) = delete;
+        unique_function& operator=(unique_function const&) = delete;
+
+        inline
+        ~unique_function()
+        {
+            reset();
+        }
+
+        inline explicit
+        operator bool() const noexcept
+        {
+            return _operations != nullptr;
+        }
+
+        inline R
+        operator()(Args... args) const
+        {
+            if(!_operations)
+                throw std::bad_function_call();
+            return _operations->invoke(_storage, std::forward<Args>(args)...);
+        }
+
+    private:
+        inline void
+        reset() noexcept
+        {
+            if(_operations)
+            {
+                _operations->destroy(_storage);
+                _operations = nullptr;
+            }
+        }
+    };
+}
+
+#endif
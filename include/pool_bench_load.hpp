@@ -0,0 +1,249 @@
+
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018 Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _POOL_BENCH_LOAD_HPP_
+#define _POOL_BENCH_LOAD_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pool_bench.hpp"
+
+namespace pool_bench
+{
+    /*
+     * Co-tenant load run beside a measurement.
+     * spin:   threads burning CPU in a dependent floating point chain
+     * memory: threads streaming read-modify-writes over a private buffer
+     *         much larger than the caches, to eat memory bandwidth
+     * pool:   a second pool, another registered runner, running another
+     *         suite over and over from a harness thread of its own
+     */
+    struct load_spec
+    {
+        enum class kind
+        {
+            spin,
+            memory,
+            pool
+        };
+
+        kind type;
+        unsigned threads;
+        /* Names of a pool load as given, and what the harness found for them */
+        std::string runner_name;
+        std::string suite_name;
+        runner* pool = nullptr;
+        suite* tenant = nullptr;
+
+        /* "spin", "spin:<threads>", "memory" or "memory:<threads>", where
+         * the thread count defaults to one per core, or
+         * "pool:<runner>:<suite>" */
+        static inline load_spec
+        parse(std::string const& text)
+        {
+            auto colon = text.find(':');
+            auto name = text.substr(0, colon);
+            auto result = load_spec();
+
+            if(name == "spin")
+                result.type = kind::spin;
+            else if(name == "memory")
+                result.type = kind::memory;
+            else if(name == "pool")
+            {
+                auto second = colon == std::string::npos
+                    ? std::string::npos : text.find(':', colon + 1);
+                if(second == std::string::npos || second == colon + 1 || second + 1 == text.size())
+                    throw std::invalid_argument("pool load needs \"pool:<runner>:<suite>\"");
+                result.type = kind::pool;
+                result.threads = 1;
+                result.runner_name = text.substr(colon + 1, second - colon - 1);
+                result.suite_name = text.substr(second + 1);
+                return result;
+            }
+            else
+                throw std::invalid_argument("unknown load \"" + text + "\"");
+
+            result.threads = colon == std::string::npos
+                ? std::max(1u, std::thread::hardware_concurrency())
+                : static_cast<unsigned>(std::max(1L, std::atol(text.c_str() + colon + 1)));
+            return result;
+        }
+
+        inline std::string
+        describe() const
+        {
+            if(type == kind::pool)
+                return std::string(pool ? pool->name() : runner_name.c_str())
+                    + " running " + (tenant ? tenant->name() : suite_name.c_str());
+            return std::to_string(threads)
+                + (type == kind::spin ? " spinning" : " memory streaming")
+                + (threads == 1 ? " thread" : " threads");
+        }
+    };
+
+    /*
+     * Runs the given loads from construction until destruction.
+     * Streaming buffers are filled before any thread starts, so they are
+     * already resident when the measured run takes its memory baseline.
+     * A pool load prepares its runner and suite here and tears them down
+     * after its last round, which the destructor waits for; one that
+     * names the measured runner or suite is left out and counted.
+     */
+    class background_load
+    {
+        std::atomic<bool> _stop;
+        std::vector<std::vector<char>> _buffers;
+        std::vector<load_spec> _pools;
+        size_t _skipped = 0;
+        std::vector<std::thread> _threads;
+
+        inline void
+        spin()
+        {
+            double x = 1.0;
+            while(!_stop.load(std::memory_order_relaxed))
+            {
+                for(int i = 0; i < 1024; ++i)
+                    x = x * 1.0000001 + 1e-9;
+            }
+            volatile double sink = x;
+            (void)sink;
+        }
+
+        inline void
+        stream(std::vector<char>& buffer)
+        {
+            while(!_stop.load(std::memory_order_relaxed))
+            {
+                for(size_t i = 0; i < buffer.size(); i += 64)
+                    ++buffer[i];
+            }
+            volatile char sink = buffer[0];
+            (void)sink;
+        }
+
+        inline void
+        cotenant(load_spec const& load)
+        {
+            auto& pool = *load.pool;
+            auto submitters = std::vector<async_function>{pool.at_priority(priority::low),
+                                                          pool(),
+                                                          pool.at_priority(priority::high)};
+            try
+            {
+                while(!_stop.load(std::memory_order_relaxed))
+                {
+                    load.tenant->reset();
+                    load.tenant->run(executor(
+                        [&submitters](task_function&& f, priority level)
+                        { return submitters[static_cast<size_t>(level)](std::move(f)); },
+                        &pool,
+                        [&pool](task_function&& f){ pool.post(std::move(f)); },
+                        [&pool](size_t begin, size_t end, size_t grain, range_function const& body)
+                        { pool.parallel_for(begin, end, grain, body); },
+                        [&pool](task_function&& f, priority level)
+                        { pool.submit_packaged(std::move(f), level); }));
+                }
+            }
+            catch(std::exception const& e)
+            {
+                std::cerr << "-- co-tenant " << load.describe() << " stopped: "
+                          << e.what() << std::endl;
+            }
+        }
+
+    public:
+        inline explicit
+        background_load(std::vector<load_spec> const& loads,
+                        runner* measured = nullptr,
+                        suite* measured_suite = nullptr)
+            : _stop(false)
+        {
+            for(auto& load : loads)
+            {
+                if(load.type == load_spec::kind::memory)
+                    _buffers.resize(_buffers.size() + load.threads, std::vector<char>(64 << 20, 1));
+                if(load.type != load_spec::kind::pool)
+                    continue;
+                if(load.pool == measured || load.tenant == measured_suite)
+                {
+                    ++_skipped;
+                    continue;
+                }
+                _pools.push_back(load);
+                load.pool->prepare();
+                load.tenant->prepare();
+            }
+
+            size_t buffer = 0;
+            for(auto& load : _pools)
+                _threads.emplace_back([this, &load]{ cotenant(load); });
+            for(auto& load : loads)
+            {
+                if(load.type == load_spec::kind::pool)
+                    continue;
+                for(unsigned n = 0; n != load.threads; ++n)
+                {
+                    if(load.type == load_spec::kind::spin)
+                    {
+                        _threads.emplace_back([this]{ spin(); });
+                    }
+                    else
+                    {
+                        auto& memory = _buffers[buffer++];
+                        _threads.emplace_back([this, &memory]{ stream(memory); });
+                    }
+                }
+            }
+        }
+
+        /* Pool loads left out for sharing the measured runner or suite */
+        inline size_t
+        skipped() const
+        {
+            return _skipped;
+        }
+
+        background_load(background_load const&) = delete;
+        background_load& operator=(background_load const&) = delete;
+
+        inline ~background_load()
+        {
+            _stop = true;
+            for(auto& i : _threads)
+                i.join();
+            for(auto& load : _pools)
+            {
+                load.tenant->teardown();
+                load.pool->teardown();
+            }
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,132 @@
+
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018 Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _POOL_BENCH_MEMORY_HPP_
+#define _POOL_BENCH_MEMORY_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace pool_bench
+{
+    /*
+     * Heap and resident memory accounting.
+     * Allocation counts come from the global operator new replacement in
+     * allocation_counter.cpp, built with -DWITH_ALLOCATION_COUNTER=ON
+     * (POOL_BENCH_COUNT_ALLOCATIONS); without it they stay at zero.
+     * Resident set sizes are read from /proc/self/status.
+     */
+    namespace memory
+    {
+        struct allocation_counts
+        {
+            uint64_t allocations;
+            uint64_t bytes;
+        };
+
+        inline constexpr bool
+        counting()
+        {
+#ifdef POOL_BENCH_COUNT_ALLOCATIONS
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        /* Shared by every operator new, so a relaxed fetch_add each */
+        inline std::atomic<uint64_t>&
+        allocation_counter()
+        {
+            static std::atomic<uint64_t> counter(0);
+            return counter;
+        }
+
+        inline std::atomic<uint64_t>&
+        byte_counter()
+        {
+            static std::atomic<uint64_t> counter(0);
+            return counter;
+        }
+
+        inline allocation_counts
+        allocations()
+        {
+            return {allocation_counter().load(std::memory_order_relaxed),
+                    byte_counter().load(std::memory_order_relaxed)};
+        }
+
+        /* A field of /proc/self/status, "Vm..." ones in kB, 0 when unavailable */
+        inline size_t
+        status_field(char const* field)
+        {
+            FILE* file = std::fopen("/proc/self/status", "r");
+            if(!file)
+                return 0;
+
+            char line[256];
+            size_t value = 0;
+            size_t length = std::strlen(field);
+            while(std::fgets(line, sizeof(line), file))
+            {
+                if(std::strncmp(line, field, length) == 0 && line[length] == ':')
+                {
+                    std::sscanf(line + length + 1, "%zu", &value);
+                    break;
+                }
+            }
+            std::fclose(file);
+            return value;
+        }
+
+        inline size_t
+        resident_kb()
+        {
+            return status_field("VmRSS");
+        }
+
+        inline size_t
+        peak_resident_kb()
+        {
+            return status_field("VmHWM");
+        }
+
+        /* Threads of the whole process, the harness's own included */
+        inline size_t
+        thread_count()
+        {
+            return status_field("Threads");
+        }
+
+        /* Restarts the peak at the current resident size, Linux 4.0 and later */
+        inline bool
+        reset_peak()
+        {
+            FILE* file = std::fopen("/proc/self/clear_refs", "w");
+            if(!file)
+                return false;
+            bool written = std::fputs("5", file) >= 0;
+            return std::fclose(file) == 0 && written;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,289 @@
+
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018 Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _POOL_BENCH_REFERENCE_HPP_
+#define _POOL_BENCH_REFERENCE_HPP_
+
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pool_bench
+{
+    /*
+     * Standard normal samples from the raw mt19937 stream.
+     * std::normal_distribution is implementation defined, this is not,
+     * so a given seed produces the same inputs with every standard library.
+     */
+    class normal_generator
+    {
+        std::mt19937 _rng;
+        float _spare;
+        bool _has_spare;
+
+        inline double
+        uniform()
+        {
+            /* (0, 1], never zero so the logarithm below stays finite */
+            return (static_cast<double>(_rng()) + 1.0) / 4294967296.0;
+        }
+
+    public:
+        inline explicit
+        normal_generator(uint32_t seed)
+            : _rng(seed), _spare(0), _has_spare(false)
+        {}
+
+        inline float
+        operator()()
+        {
+            if(_has_spare)
+            {
+                _has_spare = false;
+                return _spare;
+            }
+            double radius = std::sqrt(-2.0 * std::log(uniform()));
+            double angle = 6.283185307179586 * uniform();
+            _spare = static_cast<float>(radius * std::sin(angle));
+            _has_spare = true;
+            return static_cast<float>(radius * std::cos(angle));
+        }
+    };
+
+    /* Read only mapping of a cached reference answer */
+    class mapped_reference
+    {
+        void* _map = MAP_FAILED;
+        size_t _length = 0;
+        size_t _offset = 0;
+
+    public:
+        mapped_reference() = default;
+
+        inline
+        mapped_reference(void* map, size_t length, size_t offset)
+            : _map(map), _length(length), _offset(offset)
+        {}
+
+        mapped_reference(mapped_reference const&) = delete;
+        mapped_reference& operator=(mapped_reference const&) = delete;
+
+        inline
+        mapped_reference(mapped_reference&& other)
+            : _map(other._map), _length(other._length), _offset(other._offset)
+        {
+            other._map = MAP_FAILED;
+        }
+
+        inline mapped_reference&
+        operator=(mapped_reference&& other)
+        {
+            std::swap(_map, other._map);
+            std::swap(_length, other._length);
+            std::swap(_offset, other._offset);
+            return *this;
+        }
+
+        inline ~mapped_reference()
+        {
+            if(_map != MAP_FAILED)
+                ::munmap(_map, _length);
+        }
+
+        inline explicit operator bool() const
+        {
+            return _map != MAP_FAILED;
+        }
+
+        inline void const*
+        data() const
+        {
+            return static_cast<char const*>(_map) + _offset;
+        }
+
+        inline size_t
+        size() const
+        {
+            return _length - _offset;
+        }
+    };
+
+    /*
+     * Reference answers are cached on disk, one file per
+     * (suite, revision, problem size, seed, build), in $POOL_BENCH_CACHE
+     * or ./.pool_bench_cache. Bumping the revision string invalidates the
+     * files of a suite whose reference computation changed; the build
+     * fingerprint keeps apart answers of compilers and flags that round
+     * floating point differently.
+     */
+    namespace reference
+    {
+        struct header
+        {
+            char magic[8];
+            uint64_t bytes;
+        };
+
+        inline std::string
+        cache_directory()
+        {
+            auto dir = std::getenv("POOL_BENCH_CACHE");
+            return dir ? dir : ".pool_bench_cache";
+        }
+
+        /*
+         * Hash of the compiler version and of the predefined macros that
+         * change floating point results, as seen by the suite including
+         * this header.
+         */
+        inline std::string
+        build_fingerprint()
+        {
+            std::string build = __VERSION__;
+#ifdef __FAST_MATH__
+            build += " fast-math";
+#endif
+#ifdef __FP_FAST_FMAF
+            build += " fmaf";
+#endif
+#ifdef __FMA__
+            build += " fma";
+#endif
+#ifdef __AVX__
+            build += " avx";
+#endif
+#ifdef __FLT_EVAL_METHOD__
+            build += " eval" + std::to_string(__FLT_EVAL_METHOD__);
+#endif
+            /* FNV-1a */
+            uint64_t hash = 14695981039346656037ull;
+            for(auto c : build)
+            {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= 1099511628211ull;
+            }
+            char hex[17];
+            std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+            return hex;
+        }
+
+        inline std::string
+        cache_path(std::string const& suite,
+                   std::string const& revision,
+                   size_t problem_size,
+                   uint64_t seed)
+        {
+            auto key = suite + "-" + revision + "-"
+                + std::to_string(problem_size) + "-" + std::to_string(seed)
+                + "-" + build_fingerprint();
+            for(auto& c : key)
+            {
+                if(!std::isalnum(static_cast<unsigned char>(c)) && c != '-')
+                    c = '_';
+            }
+            return cache_directory() + "/" + key + ".bin";
+        }
+
+        inline mapped_reference
+        load(std::string const& path, size_t bytes)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if(fd < 0)
+                return {};
+
+            struct stat info;
+            size_t length = sizeof(header) + bytes;
+            if(::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) != length)
+            {
+                ::close(fd);
+                return {};
+            }
+
+            void* map = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if(map == MAP_FAILED)
+                return {};
+
+            auto file = mapped_reference(map, length, sizeof(header));
+            auto head = static_cast<header const*>(map);
+            if(std::memcmp(head->magic, "PBREF01", 8) != 0 || head->bytes != bytes)
+                return {};
+            return file;
+        }
+
+        /* Written to a temporary file and renamed, so readers never see half a file */
+        inline bool
+        store(std::string const& path, void const* data, size_t bytes)
+        {
+            ::mkdir(cache_directory().c_str(), 0755);
+
+            auto temporary = path + ".tmp" + std::to_string(::getpid());
+            FILE* file = std::fopen(temporary.c_str(), "wb");
+            if(!file)
+                return false;
+
+            header head = {{'P', 'B', 'R', 'E', 'F', '0', '1', '\0'}, bytes};
+            bool written = std::fwrite(&head, sizeof(head), 1, file) == 1
+                && std::fwrite(data, 1, bytes, file) == bytes;
+            written = std::fclose(file) == 0 && written;
+
+            if(!written || std::rename(temporary.c_str(), path.c_str()) != 0)
+            {
+                std::remove(temporary.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        /*
+         * Fills `answer` from the cache, or runs `compute(answer)` and caches
+         * the result. Returns true on a cache hit.
+         */
+        template<typename T, typename F>
+        inline bool
+        cached(std::string const& path, std::vector<T>& answer, F&& compute)
+        {
+            size_t bytes = answer.size() * sizeof(T);
+            auto file = load(path, bytes);
+            if(file)
+            {
+                std::memcpy(answer.data(), file.data(), bytes);
+                return true;
+            }
+
+            compute(answer);
+            store(path, answer.data(), bytes);
+            return false;
+        }
+    }
+}
+
+#endif
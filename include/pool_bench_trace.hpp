@@ -0,0 +1,263 @@
+
+/*
+ * thread-pool-benchmark, a C++ Thread Pool Colosseum
+ * Copyright (C) 2018 Red-Portal
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _POOL_BENCH_TRACE_HPP_
+#define _POOL_BENCH_TRACE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace pool_bench
+{
+    namespace chrono = std::chrono;
+
+    /* Small sequential id of the calling thread, stable for its lifetime */
+    inline uint32_t
+    trace_thread_id()
+    {
+        static std::atomic<uint32_t> next(0);
+        static thread_local uint32_t id = next++;
+        return id;
+    }
+
+    /*
+     * One executed task, times in nanoseconds since the tracer's origin;
+     * stolen as pool_bench::running_stolen() read when it started
+     */
+    struct trace_event
+    {
+        char const* name;
+        int64_t submit;
+        int64_t start;
+        int64_t stop;
+        uint32_t submitter;
+        int stolen;
+    };
+
+    /*
+     * Per-task timeline of one run, exported as Chrome trace JSON
+     * (chrome://tracing, ui.perfetto.dev).
+     * Every thread records into its own ring buffer, registered the first
+     * time it records for this tracer; recording itself takes no lock.
+     * Buffers start small and grow up to the capacity, since pools that
+     * start a thread per task record only a few events on each. When a
+     * buffer wraps, the oldest events are overwritten and counted
+     * as dropped. Buffers are read only after the run has joined its tasks.
+     */
+    class tracer
+    {
+        struct buffer
+        {
+            uint32_t thread;
+            uint64_t written;
+            std::vector<trace_event> events;
+        };
+
+        struct local_slot
+        {
+            uint64_t generation = 0;
+            buffer* events = nullptr;
+        };
+
+        chrono::steady_clock::time_point _origin;
+        size_t _capacity;
+        uint64_t _generation;
+        uint32_t _harness;
+        std::mutex _lock;
+        std::vector<std::unique_ptr<buffer>> _buffers;
+        std::deque<std::string> _labels;
+
+        static inline uint64_t
+        next_generation()
+        {
+            static std::atomic<uint64_t> generation(0);
+            return ++generation;
+        }
+
+        static inline local_slot&
+        slot()
+        {
+            static thread_local local_slot local;
+            return local;
+        }
+
+        inline buffer*
+        local()
+        {
+            auto& local = slot();
+            if(local.generation != _generation)
+            {
+                auto events = std::unique_ptr<buffer>(
+                    new buffer{trace_thread_id(), 0,
+                               std::vector<trace_event>(std::min<size_t>(_capacity, 64))});
+                std::lock_guard<std::mutex> guard(_lock);
+                _buffers.emplace_back(std::move(events));
+                local.events = _buffers.back().get();
+                local.generation = _generation;
+            }
+            return local.events;
+        }
+
+        static inline void
+        write_escaped(FILE* file, char const* text)
+        {
+            for(; *text; ++text)
+            {
+                if(*text == '"' || *text == '\\')
+                    std::fputc('\\', file);
+                if(static_cast<unsigned char>(*text) >= 0x20)
+                    std::fputc(*text, file);
+            }
+        }
+
+    public:
+        inline explicit
+        tracer(size_t capacity = 1 << 16)
+            : _origin(chrono::steady_clock::now()),
+              _capacity(capacity),
+              _generation(next_generation()),
+              _harness(trace_thread_id())
+        {}
+
+        tracer(tracer const&) = delete;
+        tracer& operator=(tracer const&) = delete;
+
+        inline int64_t
+        now() const
+        {
+            return chrono::duration_cast<chrono::nanoseconds>(
+                chrono::steady_clock::now() - _origin).count();
+        }
+
+        /* A copy of the event name that lives as long as the tracer.
+         * Takes a lock and searches, so callers keep what it returns */
+        inline char const*
+        label(std::string const& name)
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            for(auto& i : _labels)
+            {
+                if(i == name)
+                    return i.c_str();
+            }
+            _labels.push_back(name);
+            return _labels.back().c_str();
+        }
+
+        inline void
+        record(trace_event const& event)
+        {
+            auto events = local();
+            if(events->written == events->events.size() && events->written < _capacity)
+                events->events.resize(std::min<size_t>(2 * events->events.size(), _capacity));
+            events->events[events->written % _capacity] = event;
+            ++events->written;
+        }
+
+        inline uint64_t
+        dropped() const
+        {
+            uint64_t total = 0;
+            for(auto& i : _buffers)
+                total += i->written > _capacity ? i->written - _capacity : 0;
+            return total;
+        }
+
+        /*
+         * One complete ("X") event per task on the executing thread's track.
+         * args.queued_us is the time between submission and start,
+         * args.submitter the thread that submitted it, and args.stolen
+         * whether it came from another worker's queue, where the pool
+         * tells.
+         */
+        inline bool
+        write(std::string const& path, std::string const& process) const
+        {
+            FILE* file = std::fopen(path.c_str(), "w");
+            if(!file)
+                return false;
+
+            std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+            std::fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"");
+            write_escaped(file, process.c_str());
+            std::fprintf(file, "\"}},\n");
+            std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                         "\"args\":{\"name\":\"harness\"}}", _harness);
+
+            for(auto& i : _buffers)
+            {
+                if(i->thread != _harness)
+                    std::fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                                 "\"args\":{\"name\":\"worker %u\"}}", i->thread, i->thread);
+
+                auto count = std::min<uint64_t>(i->written, _capacity);
+                for(uint64_t e = 0; e < count; ++e)
+                {
+                    auto& event = i->events[e];
+                    std::fprintf(file, ",\n{\"name\":\"");
+                    write_escaped(file, event.name);
+                    std::fprintf(file, "\",\"cat\":\"task\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                                 "\"ts\":%.3f,\"dur\":%.3f,"
+                                 "\"args\":{\"queued_us\":%.3f,\"submitter\":%u%s}}",
+                                 i->thread,
+                                 event.start / 1e3,
+                                 (event.stop - event.start) / 1e3,
+                                 (event.start - event.submit) / 1e3,
+                                 event.submitter,
+                                 event.stolen < 0 ? ""
+                                 : event.stolen ? ",\"stolen\":true" : ",\"stolen\":false");
+                }
+            }
+            std::fprintf(file, "\n]}\n");
+            return std::fclose(file) == 0;
+        }
+    };
+
+    namespace trace
+    {
+        /* <directory>/<suite>-<runner>.json, created if missing */
+        inline std::string
+        file_path(std::string const& directory,
+                  std::string const& suite,
+                  std::string const& runner)
+        {
+            ::mkdir(directory.c_str(), 0755);
+            auto key = suite + "-" + runner;
+            for(auto& c : key)
+            {
+                if(!std::isalnum(static_cast<unsigned char>(c)) && c != '-')
+                    c = '_';
+            }
+            return directory + "/" + key + ".json";
+        }
+    }
+}
+
+#endif
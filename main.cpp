@@ -17,16 +17,33 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <chrono>
 #include <cstdlib>
 #include <future>
+#include <iomanip>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <numeric>
 #include <random>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <tuple>
 
 #include "pool_bench.hpp"
+#include "pool_bench_clock.hpp"
+#include "pool_bench_load.hpp"
+#include "pool_bench_memory.hpp"
+#include "pool_bench_trace.hpp"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <boost/spirit/include/karma.hpp>
 
@@ -52,31 +69,208 @@ namespace pool_bench
         return retval;
     }
 
-    template<typename F>
-    inline std::tuple<chrono::nanoseconds, chrono::nanoseconds>
-    execute_benchmark(F&& f, pool_bench::suite& task)
+    struct phase_result
+    {
+        std::string name;
+        size_t entries;
+        chrono::nanoseconds wall;
+        chrono::nanoseconds barrier;
+        chrono::nanoseconds busy;
+    };
+
+    struct benchmark_result
+    {
+        chrono::nanoseconds fork;
+        chrono::nanoseconds join;
+        std::vector<phase_result> phases;
+        size_t tasks;
+        size_t untimed;
+    };
+
+    /*
+     * Fork time is measured per submission on the harness thread with the
+     * tick_clock, on every sample_every-th submission only. The sampled
+     * intervals, less the clock's own overhead, are scaled up to all
+     * submissions. The task count takes in those made from the workers
+     * and the chunks of a pool's loop too.
+     * Samples go into a buffer allocated and touched before the run, as
+     * problem_size() only hints at the submissions; once it is full the
+     * rest go untimed and are counted, rather than growing it mid-run.
+     */
+    inline benchmark_result
+    execute_benchmark(pool_bench::runner& pool,
+                      pool_bench::suite& task,
+                      pool_bench::tracer* trace = nullptr,
+                      size_t sample_every = 1)
     {
-        auto insertion = std::vector<chrono::nanoseconds>();
-        insertion.reserve(task.problem_size());
+        auto submitters = std::vector<async_function>{pool.at_priority(priority::low),
+                                                       pool(),
+                                                       pool.at_priority(priority::high)};
+        auto& clock = pool_bench::tick_clock::get();
+        constexpr size_t min_samples = 1 << 18;
+        auto insertion = std::vector<uint64_t>(std::max<size_t>(task.problem_size() / sample_every + 1,
+                                                                min_samples));
+        insertion.clear();
+        size_t submissions = 0;
+        size_t untimed = 0;
+        std::atomic<size_t> tasks{0};
 
-        auto async_call = [&f, &insertion](std::function<void(void)>&& task)
+        pool_bench::phase_recorder phases;
+        pool_bench::phase_recorder::current() = &phases;
+
+        /* Tasks may submit further tasks from the workers; that is part of
+         * their execution, only the harness thread's submissions are forking */
+        auto harness = std::this_thread::get_id();
+
+        /* Interning takes the tracer's lock; do it once per phase, not
+         * once per submission */
+        auto task_label = trace ? trace->label("task") : nullptr;
+        auto label_of = [trace, task_label](pool_bench::phase_timing* phase)
+                        {
+                            if(!phase)
+                                return task_label;
+                            auto label = phase->trace_label.load(std::memory_order_acquire);
+                            if(!label)
+                            {
+                                label = trace->label(phase->name);
+                                phase->trace_label.store(label, std::memory_order_release);
+                            }
+                            return label;
+                        };
+        auto instrument = [&phases, &tasks, trace, &label_of](task_function& task)
+                          {
+                              tasks.fetch_add(1, std::memory_order_relaxed);
+                              auto phase = phases.active();
+                              if(trace)
+                              {
+                                  auto label = label_of(phase);
+                                  task = [trace, label,
+                                          submit = trace->now(),
+                                          submitter = pool_bench::trace_thread_id(),
+                                          task = std::move(task)]
+                                         {
+                                             auto start = trace->now();
+                                             auto stolen = pool_bench::running_stolen();
+                                             task();
+                                             trace->record({label, submit, start, trace->now(),
+                                                            submitter, stolen});
+                                         };
+                              }
+                              if(phase)
+                              {
+                                  task = [phase, task = std::move(task)]
+                                         {
+                                             auto start = chrono::steady_clock::now();
+                                             task();
+                                             auto stop = chrono::steady_clock::now();
+                                             phase->busy += (stop - start).count();
+                                         };
+                              }
+                          };
+        auto timed = [&submissions, &untimed, &insertion, harness, sample_every]
+                     {
+                         if(std::this_thread::get_id() != harness
+                            || submissions++ % sample_every != 0)
+                             return false;
+                         if(insertion.size() == insertion.capacity())
+                         {
+                             ++untimed;
+                             return false;
+                         }
+                         return true;
+                     };
+
+        auto async_call = [&submitters, &clock, &insertion, &instrument, &timed]
+                          (task_function&& task, priority level)
                           {
-                              auto insert_start = chrono::steady_clock::now();
+                              auto& f = submitters[static_cast<size_t>(level)];
+                              instrument(task);
+                              if(!timed())
+                                  return f(std::move(task));
+
+                              auto insert_start = clock.now();
                               auto future = f(std::move(task));
-                              auto insert_stop = chrono::steady_clock::now();
-                              insertion.emplace_back(insert_stop - insert_start);
+                              auto insert_stop = clock.now();
+                              insertion.push_back(clock.corrected(insert_stop - insert_start));
                               return future;
                           };
+        auto post_call = [&pool, &clock, &insertion, &instrument, &timed](task_function&& task)
+                         {
+                             instrument(task);
+                             if(!timed())
+                                 return pool.post(std::move(task));
+
+                             auto insert_start = clock.now();
+                             pool.post(std::move(task));
+                             auto insert_stop = clock.now();
+                             insertion.push_back(clock.corrected(insert_stop - insert_start));
+                         };
+        auto packaged_call = [&pool, &clock, &insertion, &instrument, &timed]
+                             (task_function&& task, priority level)
+                             {
+                                 instrument(task);
+                                 if(!timed())
+                                     return pool.submit_packaged(std::move(task), level);
+
+                                 auto insert_start = clock.now();
+                                 pool.submit_packaged(std::move(task), level);
+                                 auto insert_stop = clock.now();
+                                 insertion.push_back(clock.corrected(insert_stop - insert_start));
+                             };
+
+        /* A pool's own loop is one blocking call from the harness thread, so
+         * it counts as joining; its chunks are traced and timed as tasks */
+        auto for_call = [&pool, &phases, &tasks, trace, &label_of](size_t begin, size_t end, size_t grain,
+                                                                   pool_bench::range_function const& body)
+                        {
+                            auto chunk = std::max<size_t>(grain, 1);
+                            tasks.fetch_add((end - std::min(begin, end) + chunk - 1) / chunk,
+                                            std::memory_order_relaxed);
+                            auto phase = phases.active();
+                            if(!trace && !phase)
+                                return pool.parallel_for(begin, end, grain, body);
+
+                            auto label = trace ? label_of(phase) : nullptr;
+                            auto submit = trace ? trace->now() : 0;
+                            auto submitter = pool_bench::trace_thread_id();
+                            pool.parallel_for(
+                                begin, end, grain,
+                                [&body, phase, trace, label, submit, submitter](size_t first, size_t last)
+                                {
+                                    auto trace_start = trace ? trace->now() : 0;
+                                    auto stolen = pool_bench::running_stolen();
+                                    auto start = chrono::steady_clock::now();
+                                    body(first, last);
+                                    auto stop = chrono::steady_clock::now();
+                                    if(phase)
+                                        phase->busy += (stop - start).count();
+                                    if(trace)
+                                        trace->record({label, submit, trace_start, trace->now(),
+                                                       submitter, stolen});
+                                });
+                        };
 
         auto span_start = chrono::steady_clock::now();
-        task.run(std::move(async_call));
+        task.run(pool_bench::executor(std::move(async_call), &pool,
+                                      std::move(post_call), std::move(for_call),
+                                      std::move(packaged_call)));
         auto span_stop = chrono::steady_clock::now();
+        pool_bench::phase_recorder::current() = nullptr;
 
-        auto insert_duration = std::accumulate(insertion.begin(),
-                                               insertion.end(),
-                                               chrono::nanoseconds());
+        auto sampled = std::accumulate(insertion.begin(), insertion.end(), 0.0);
+        auto scale = insertion.empty()
+            ? 0.0 : static_cast<double>(submissions) / insertion.size();
         auto span_duration = span_stop - span_start;
-        return {insert_duration, span_duration - insert_duration};
+        /* A sampled estimate can overshoot when submission costs vary widely */
+        auto insert_duration = std::min<chrono::nanoseconds>(clock.to_duration(sampled * scale),
+                                                             span_duration);
+
+        auto result = benchmark_result{insert_duration, span_duration - insert_duration, {},
+                                       tasks.load(), untimed};
+        for(auto& i : phases.phases())
+            result.phases.push_back({i.name, i.entries, i.wall, i.barrier,
+                                     chrono::nanoseconds(i.busy.load())});
+        return result;
     }
 
     template<typename Duration>
@@ -98,12 +292,456 @@ namespace pool_bench
         return {header_format, report_format};
     }
 
+    /* Per phase breakdown of multi-stage suites, printed under the runner's row */
+    inline void
+    print_phases(std::vector<phase_result> const& phases)
+    {
+        if(phases.empty())
+            return;
+
+        printf("    %-12s  %12s  %12s  %12s\n",
+               "< phase >", "< wall >", "< barrier >", "< busy >");
+        for(auto& i : phases)
+        {
+            printf("    %-12s  %10fms  %10fms  %10fms\n",
+                   i.name.c_str(),
+                   format_time(i.wall),
+                   format_time(i.barrier),
+                   format_time(i.busy));
+        }
+    }
+
+    struct options
+    {
+        bool isolate = false;
+        std::string trace_directory;
+        size_t fork_sample = 1;
+        bool memory = false;
+        unsigned workers = 0;
+        std::vector<pool_bench::load_spec> loads;
+        std::vector<std::string> concurrent;
+    };
+
+    inline void
+    print_usage(char const* program)
+    {
+        std::cout << "usage: " << program
+                  << " [--isolate] [--trace <directory>] [--fork-sample <n>] [--memory]\n"
+                  << "       [--workers <n>] [--load spin|memory[:<threads>]|pool:<runner>:<suite>]...\n"
+                  << "       [--concurrent <suite>,<suite>[,...]]\n"
+                  << "  --isolate            run every (suite, runner) pair in a fresh child process\n"
+                  << "  --trace <directory>  write a Chrome trace of every run's tasks\n"
+                  << "  --fork-sample <n>    time only every n-th submission and scale up\n"
+                  << "  --memory             report allocations and peak resident memory per run\n"
+                  << "  --workers <n>        start n workers in pools that take a count, more than\n"
+                  << "                       the cores to oversubscribe\n"
+                  << "  --load <load>        measure every run alone and beside spinning or memory\n"
+                  << "                       streaming threads, one per core unless given, or\n"
+                  << "                       another runner's pool running a suite in a loop\n"
+                  << "  --concurrent <list>  run the listed suites at once on every runner, named\n"
+                  << "                       in lower case with '_' for other characters\n";
+    }
+
+    inline options
+    parse_options(int argc, char** argv)
+    {
+        auto result = options();
+        for(int i = 1; i < argc; ++i)
+        {
+            auto arg = std::string(argv[i]);
+            if(arg == "--isolate")
+                result.isolate = true;
+            else if(arg == "--trace" && i + 1 < argc)
+                result.trace_directory = argv[++i];
+            else if(arg == "--memory")
+                result.memory = true;
+            else if(arg == "--workers" && i + 1 < argc)
+                result.workers = static_cast<unsigned>(std::max(0L, std::atol(argv[++i])));
+            else if(arg == "--load" && i + 1 < argc)
+            {
+                try
+                {
+                    result.loads.push_back(pool_bench::load_spec::parse(argv[++i]));
+                }
+                catch(std::invalid_argument const& e)
+                {
+                    std::cerr << e.what() << "\n";
+                    print_usage(argv[0]);
+                    std::exit(1);
+                }
+            }
+            else if(arg == "--concurrent" && i + 1 < argc)
+            {
+                std::istringstream list(argv[++i]);
+                for(std::string name; std::getline(list, name, ',');)
+                {
+                    if(!name.empty())
+                        result.concurrent.push_back(name);
+                }
+                if(result.concurrent.size() < 2)
+                {
+                    std::cerr << "--concurrent needs at least two suites\n";
+                    print_usage(argv[0]);
+                    std::exit(1);
+                }
+            }
+            else if(arg == "--fork-sample" && i + 1 < argc)
+                result.fork_sample = std::max(1L, std::atol(argv[++i]));
+            else if(arg == "--help" || arg == "-h")
+            {
+                print_usage(argv[0]);
+                std::exit(0);
+            }
+            else
+            {
+                std::cerr << "unknown option " << arg << "\n";
+                print_usage(argv[0]);
+                std::exit(1);
+            }
+        }
+        return result;
+    }
+
+    /*
+     * construct:  runner::prepare(), creating the pool
+     * first task: submitting an empty task to the fresh pool until it has
+     *             run, which includes thread start up for lazy pools
+     * shutdown:   runner::teardown(), stopping and joining the workers
+     */
+    struct lifecycle_result
+    {
+        chrono::nanoseconds construct;
+        chrono::nanoseconds first_task;
+        chrono::nanoseconds shutdown;
+    };
+
+    /*
+     * Heap allocations made during the run (with the allocation counter
+     * built in), and the resident set at its start and at its peak
+     */
+    struct memory_result
+    {
+        uint64_t allocations;
+        uint64_t bytes;
+        size_t tasks;
+        size_t start_kb;
+        size_t peak_kb;
+    };
+
+    /* Everything printed for one (suite, runner) pair */
+    struct run_outcome
+    {
+        benchmark_result timing;
+        lifecycle_result lifecycle;
+        scheduler_stats stats;
+        memory_result memory;
+        chrono::nanoseconds idle_total;
+        size_t skipped_loads;
+        std::string report;
+        bool correct;
+    };
+
+    inline run_outcome
+    run_in_process(pool_bench::suite& task,
+                   pool_bench::runner& pool,
+                   options const& settings)
+    {
+        auto outcome = run_outcome();
+
+        auto construct_start = chrono::steady_clock::now();
+        pool.prepare();
+        auto construct_stop = chrono::steady_clock::now();
+        pool()([]{}).get();
+        auto first_task_stop = chrono::steady_clock::now();
+        outcome.lifecycle.construct = construct_stop - construct_start;
+        outcome.lifecycle.first_task = first_task_stop - construct_stop;
+
+        /* Under --load the same pool first runs the suite on its own */
+        std::unique_ptr<pool_bench::background_load> load;
+        if(!settings.loads.empty())
+        {
+            task.reset();
+            auto idle = pool_bench::execute_benchmark(pool, task, nullptr, settings.fork_sample);
+            outcome.idle_total = idle.fork + idle.join;
+            load.reset(new pool_bench::background_load(settings.loads, &pool, &task));
+            outcome.skipped_loads = load->skipped();
+        }
+
+        task.reset();
+        pool.reset_stats();
+        if(settings.memory)
+        {
+            pool_bench::memory::reset_peak();
+            outcome.memory.start_kb = pool_bench::memory::resident_kb();
+        }
+        auto allocations = pool_bench::memory::allocations();
+
+        if(settings.trace_directory.empty())
+            outcome.timing = pool_bench::execute_benchmark(pool, task, nullptr,
+                                                           settings.fork_sample);
+        else
+        {
+            pool_bench::tracer trace;
+            outcome.timing = pool_bench::execute_benchmark(pool, task, &trace,
+                                                           settings.fork_sample);
+            auto path = pool_bench::trace::file_path(settings.trace_directory,
+                                                     task.name(), pool.name());
+            if(!trace.write(path, std::string(task.name()) + " on " + pool.name()))
+                std::cerr << "-- could not write trace " << path << std::endl;
+            else if(trace.dropped() > 0)
+                std::cerr << "-- trace " << path << " dropped "
+                          << trace.dropped() << " oldest events" << std::endl;
+        }
+        load.reset();
+
+        if(settings.memory)
+        {
+            auto counts = pool_bench::memory::allocations();
+            outcome.memory.allocations = counts.allocations - allocations.allocations;
+            outcome.memory.bytes = counts.bytes - allocations.bytes;
+            outcome.memory.tasks = outcome.timing.tasks;
+            outcome.memory.peak_kb = pool_bench::memory::peak_resident_kb();
+        }
+
+        outcome.stats = pool.stats();
+        outcome.report = task.report();
+        outcome.correct = task.check_result();
+
+        auto shutdown_start = chrono::steady_clock::now();
+        pool.teardown();
+        outcome.lifecycle.shutdown = chrono::steady_clock::now() - shutdown_start;
+        return outcome;
+    }
+
+    inline std::string
+    serialize(run_outcome const& outcome)
+    {
+        std::ostringstream out;
+        out << outcome.correct << ' '
+            << outcome.timing.fork.count() << ' '
+            << outcome.timing.join.count() << ' '
+            << outcome.timing.untimed << ' '
+            << outcome.lifecycle.construct.count() << ' '
+            << outcome.lifecycle.first_task.count() << ' '
+            << outcome.lifecycle.shutdown.count() << ' '
+            << outcome.memory.allocations << ' '
+            << outcome.memory.bytes << ' '
+            << outcome.memory.tasks << ' '
+            << outcome.memory.start_kb << ' '
+            << outcome.memory.peak_kb << ' '
+            << outcome.idle_total.count() << ' '
+            << outcome.skipped_loads << ' '
+            << std::quoted(outcome.report) << ' '
+            << outcome.timing.phases.size();
+        for(auto& i : outcome.timing.phases)
+        {
+            out << ' ' << std::quoted(i.name) << ' ' << i.entries << ' '
+                << i.wall.count() << ' ' << i.barrier.count() << ' ' << i.busy.count();
+        }
+
+        out << ' ' << outcome.stats.failed_try_push
+            << ' ' << outcome.stats.push_fallbacks
+            << ' ' << outcome.stats.workers.size();
+        for(auto& i : outcome.stats.workers)
+        {
+            out << ' ' << i.executed << ' ' << i.steals << ' ' << i.failed_steals
+                << ' ' << i.blocked.count() << ' ' << i.peak_depth;
+        }
+        return out.str();
+    }
+
+    inline run_outcome
+    deserialize(std::string const& bytes)
+    {
+        std::istringstream in(bytes);
+        auto outcome = run_outcome();
+        chrono::nanoseconds::rep fork, join, construct, first_task, shutdown, idle_total;
+        size_t phases = 0;
+        in >> outcome.correct >> fork >> join >> outcome.timing.untimed >> construct >> first_task >> shutdown
+           >> outcome.memory.allocations >> outcome.memory.bytes >> outcome.memory.tasks
+           >> outcome.memory.start_kb >> outcome.memory.peak_kb >> idle_total
+           >> outcome.skipped_loads
+           >> std::quoted(outcome.report) >> phases;
+        outcome.timing.fork = chrono::nanoseconds(fork);
+        outcome.timing.join = chrono::nanoseconds(join);
+        outcome.idle_total = chrono::nanoseconds(idle_total);
+        outcome.lifecycle = {chrono::nanoseconds(construct),
+                             chrono::nanoseconds(first_task),
+                             chrono::nanoseconds(shutdown)};
+
+        for(size_t i = 0; i < phases && in; ++i)
+        {
+            auto phase = phase_result();
+            chrono::nanoseconds::rep wall, barrier, busy;
+            in >> std::quoted(phase.name) >> phase.entries >> wall >> barrier >> busy;
+            phase.wall = chrono::nanoseconds(wall);
+            phase.barrier = chrono::nanoseconds(barrier);
+            phase.busy = chrono::nanoseconds(busy);
+            outcome.timing.phases.push_back(std::move(phase));
+        }
+
+        size_t workers = 0;
+        in >> outcome.stats.failed_try_push >> outcome.stats.push_fallbacks >> workers;
+        for(size_t i = 0; i < workers && in; ++i)
+        {
+            auto worker = worker_stats();
+            chrono::nanoseconds::rep blocked;
+            in >> worker.executed >> worker.steals >> worker.failed_steals
+               >> blocked >> worker.peak_depth;
+            worker.blocked = chrono::nanoseconds(blocked);
+            outcome.stats.workers.push_back(worker);
+        }
+
+        if(!in)
+            throw std::runtime_error("Error: malformed result from benchmark process\n");
+        return outcome;
+    }
+
+    /*
+     * Runs the pair in a forked child, so that no pool's threads, global
+     * workers or heap state outlive it into the next runner's measurement.
+     * The suite is prepared in the parent and shared copy-on-write; the
+     * child sends its outcome back over a pipe.
+     */
+    inline run_outcome
+    run_isolated(pool_bench::suite& task,
+                 pool_bench::runner& pool,
+                 options const& settings)
+    {
+        int channel[2];
+        if(::pipe(channel) != 0)
+            throw std::runtime_error("Error: could not create pipe for benchmark process\n");
+
+        std::cout.flush();
+        std::fflush(stdout);
+
+        pid_t child = ::fork();
+        if(child < 0)
+            throw std::runtime_error("Error: could not fork benchmark process\n");
+
+        if(child == 0)
+        {
+            ::close(channel[0]);
+            int status = 0;
+            try
+            {
+                auto bytes = serialize(run_in_process(task, pool, settings));
+                for(size_t written = 0; written < bytes.size();)
+                {
+                    auto n = ::write(channel[1], bytes.data() + written, bytes.size() - written);
+                    if(n <= 0)
+                    {
+                        status = 1;
+                        break;
+                    }
+                    written += static_cast<size_t>(n);
+                }
+            }
+            catch(std::exception const& e)
+            {
+                std::cerr << e.what() << std::endl;
+                status = 1;
+            }
+            ::close(channel[1]);
+            /* Skips the static destructors of the parent's registrations */
+            ::_exit(status);
+        }
+
+        ::close(channel[1]);
+        std::string bytes;
+        char buffer[4096];
+        ssize_t n;
+        while((n = ::read(channel[0], buffer, sizeof(buffer))) > 0)
+            bytes.append(buffer, static_cast<size_t>(n));
+        ::close(channel[0]);
+
+        int status = 0;
+        ::waitpid(child, &status, 0);
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            std::string err = "Error: benchmark process failed while running \""s
+                + std::string(task.name()) + "\" on \""s + std::string(pool.name()) + "\"\n"s;
+            throw std::runtime_error(err);
+        }
+        return deserialize(bytes);
+    }
+
+    /* Scheduler counters of pools that keep them, printed under the runner's row */
+    inline void
+    print_stats(scheduler_stats const& stats)
+    {
+        if(stats.workers.empty())
+            return;
+
+        printf("    %-10s  %10s  %10s  %18s  %12s  %14s\n",
+               "< worker >", "< tasks >", "< steals >", "< failed steals >",
+               "< blocked >", "< peak depth >");
+        for(size_t i = 0; i < stats.workers.size(); ++i)
+        {
+            auto& worker = stats.workers[i];
+            printf("    %-10zu  %10zu  %10zu  %18zu  %10fms  %14zu\n",
+                   i,
+                   worker.executed,
+                   worker.steals,
+                   worker.failed_steals,
+                   format_time(worker.blocked),
+                   worker.peak_depth);
+        }
+        if(stats.failed_try_push > 0 || stats.push_fallbacks > 0)
+            printf("    try_push failures %zu, blocking push fallbacks %zu\n",
+                   stats.failed_try_push, stats.push_fallbacks);
+    }
+
+    inline void
+    print_memory(memory_result const& memory)
+    {
+        auto tasks = static_cast<double>(std::max<size_t>(memory.tasks, 1));
+        if(pool_bench::memory::counting())
+            printf("    %.2f allocations/task, %.1f bytes/task, ",
+                   memory.allocations / tasks,
+                   memory.bytes / tasks);
+        else
+            printf("    ");
+        printf("peak rss %.1fMB (+%.1fMB over start)\n",
+               memory.peak_kb / 1024.0,
+               (memory.peak_kb - std::min(memory.start_kb, memory.peak_kb)) / 1024.0);
+    }
+
+    /* Pool lifecycle costs of every runner, averaged over the suites */
+    inline void
+    print_lifecycles(std::vector<pool_bench::runner*> const& runners,
+                     std::vector<lifecycle_result> const& lifecycles,
+                     size_t runs,
+                     std::string const& header_format,
+                     std::string const& report_format)
+    {
+        if(runs == 0)
+            return;
+
+        std::cout << "\n-- pool lifecycle, mean over " << runs << " problems\n" << std::endl;
+        printf(header_format.c_str(),
+               "< gladiatior >",
+               "< construct >",
+               "< first task >",
+               "< shutdown >");
+        for(size_t k = 0; k < runners.size(); ++k)
+        {
+            printf(report_format.c_str(),
+                   runners[k]->name(),
+                   format_time(lifecycles[k].construct) / runs,
+                   format_time(lifecycles[k].first_task) / runs,
+                   format_time(lifecycles[k].shutdown) / runs);
+        }
+    }
+
     void run_benchmarks(std::vector<pool_bench::suite*>& suites,
-                        std::vector<pool_bench::runner*>& runners)
+                        std::vector<pool_bench::runner*>& runners,
+                        options const& settings)
     {
         auto output = make_output_format(runners);
         auto header_format = std::get<0>(output);
         auto report_format = std::get<1>(output);
+        auto lifecycles = std::vector<lifecycle_result>(runners.size());
 
         for(auto& i : suites)
         {
@@ -118,12 +756,16 @@ namespace pool_bench
                    " < joining >",
                    " < total >");
 
-            for(auto& j : runners){
-                j->prepare();
-
-                auto result = pool_bench::execute_benchmark((*j)(), *i);
-                auto fork_duration = std::get<0>(result);
-                auto join_duration = std::get<1>(result);
+            for(size_t k = 0; k < runners.size(); ++k){
+                auto& j = runners[k];
+                auto outcome = settings.isolate
+                    ? run_isolated(*i, *j, settings)
+                    : run_in_process(*i, *j, settings);
+                lifecycles[k].construct += outcome.lifecycle.construct;
+                lifecycles[k].first_task += outcome.lifecycle.first_task;
+                lifecycles[k].shutdown += outcome.lifecycle.shutdown;
+                auto fork_duration = outcome.timing.fork;
+                auto join_duration = outcome.timing.join;
                 auto total_duration = fork_duration + join_duration;
 
                 //printf("%s %10fms %10fms %10fms\n",
@@ -133,23 +775,224 @@ namespace pool_bench
                        format_time(join_duration),
                        format_time(total_duration));
 
-                if(!i->check_result())
+                if(!outcome.report.empty())
+                    std::cout << outcome.report << std::endl;
+                print_phases(outcome.timing.phases);
+                if(outcome.timing.untimed > 0)
+                    printf("    %zu sampled submissions past the buffer went untimed, raise --fork-sample\n",
+                           outcome.timing.untimed);
+                print_stats(outcome.stats);
+                if(settings.memory)
+                    print_memory(outcome.memory);
+                /* A pool load that would share this runner or suite is left out */
+                if(!settings.loads.empty() && outcome.skipped_loads == settings.loads.size())
+                    printf("    no co-tenant (same runner/suite), alone %fms\n",
+                           format_time(outcome.idle_total));
+                else if(!settings.loads.empty())
+                    printf("    under load %fms, alone %fms, slowdown %.2fx%s\n",
+                           format_time(total_duration),
+                           format_time(outcome.idle_total),
+                           format_time(total_duration)
+                           / std::max(format_time(outcome.idle_total), 1e-9),
+                           outcome.skipped_loads
+                           ? ", pool co-tenant left out (same runner/suite)" : "");
+
+                if(!outcome.correct)
                 {
                     std::string err = "Error: Incorrect computation result while running \""s
                         + std::string(i->name()) + "\" on \""s + std::string(j->name()) + "\"\n"s;
                     throw std::runtime_error(err);
                 }
-                j->teardown();
             }
             std::cout << "\n-- tearing down " << i->name() << std::endl;
             i->teardown();
             std::cout << "-- tearing down " << i->name() << " - done" << std::endl;
         }
+
+        print_lifecycles(runners, lifecycles, suites.size(), header_format, report_format);
+    }
+
+    /* "Fluid Solver (simd avx2)" -> "fluid_solver_simd_avx2" */
+    inline std::string
+    suite_key(char const* name)
+    {
+        std::string key;
+        for(auto c = name; *c; ++c)
+        {
+            if(std::isalnum(static_cast<unsigned char>(*c)))
+                key += static_cast<char>(std::tolower(static_cast<unsigned char>(*c)));
+            else if(!key.empty() && key.back() != '_')
+                key += '_';
+        }
+        while(!key.empty() && key.back() == '_')
+            key.pop_back();
+        return key;
+    }
+
+    inline std::vector<pool_bench::suite*>
+    select_suites(std::vector<pool_bench::suite*> const& suites,
+                  std::vector<std::string> const& keys)
+    {
+        auto selected = std::vector<pool_bench::suite*>();
+        for(auto& key : keys)
+        {
+            auto found = std::find_if(suites.begin(), suites.end(),
+                                      [&key](pool_bench::suite* i)
+                                      { return suite_key(i->name()) == key; });
+            if(found == suites.end())
+                throw std::runtime_error("Error: no benchmark problem named \""s + key + "\"\n"s);
+            if(!(*found)->shares_pool())
+                throw std::runtime_error("Error: \""s + (*found)->name()
+                                         + "\" cannot share its pool with other problems\n"s);
+            selected.push_back(*found);
+        }
+        return selected;
+    }
+
+    /* Finds the runner and suite of every pool load, by the same keys as suites */
+    inline void
+    resolve_loads(std::vector<pool_bench::load_spec>& loads,
+                  std::vector<pool_bench::runner*> const& runners,
+                  std::vector<pool_bench::suite*> const& suites)
+    {
+        for(auto& load : loads)
+        {
+            if(load.type != pool_bench::load_spec::kind::pool)
+                continue;
+            auto runner = std::find_if(runners.begin(), runners.end(),
+                                       [&load](pool_bench::runner* i)
+                                       { return suite_key(i->name()) == load.runner_name; });
+            if(runner == runners.end())
+                throw std::runtime_error("Error: no subject named \""s + load.runner_name + "\"\n"s);
+            load.pool = *runner;
+            load.tenant = select_suites(suites, {load.suite_name}).front();
+        }
+    }
+
+    /*
+     * Runs the selected suites one after another and then all at once on
+     * the same pool, each from its own harness thread, released together.
+     * A suite's slowdown is its concurrent span over its span alone; the
+     * makespan is from the release until the last suite is done, and
+     * speedup is the sum of the spans alone over the makespan.
+     */
+    void run_concurrent(std::vector<pool_bench::suite*> const& suites,
+                        std::vector<pool_bench::runner*>& runners,
+                        options const& settings)
+    {
+        size_t max_len = 0;
+        for(auto& i : suites)
+            max_len = std::max(max_len, std::string(i->name()).size());
+        auto header_format = "    %-"s + std::to_string(max_len) + "s  %12s  %12s  %12s\n"s;
+        auto report_format = "    %-"s + std::to_string(max_len) + "s  %10fms  %10fms  %11.2fx\n"s;
+
+        for(auto& i : suites)
+        {
+            std::cout << "-- preparing " << i->name() << std::endl;
+            i->prepare();
+            std::cout << "-- preparing " << i->name() << " - done" << std::endl;
+        }
+        std::cout << std::endl;
+
+        for(auto& pool : runners)
+        {
+            pool->prepare();
+            (*pool)()([]{}).get();
+
+            auto alone = std::vector<chrono::nanoseconds>();
+            for(auto& i : suites)
+            {
+                i->reset();
+                auto result = pool_bench::execute_benchmark(*pool, *i, nullptr, settings.fork_sample);
+                alone.push_back(result.fork + result.join);
+            }
+
+            for(auto& i : suites)
+                i->reset();
+            auto shared = std::vector<chrono::nanoseconds>(suites.size());
+            auto counted = std::vector<size_t>(suites.size());
+            auto errors = std::vector<std::string>(suites.size());
+            auto release = std::promise<void>();
+            auto start = release.get_future().share();
+            auto threads = std::vector<std::thread>();
+            for(size_t k = 0; k < suites.size(); ++k)
+            {
+                threads.emplace_back([&, k]
+                                     {
+                                         start.wait();
+                                         try
+                                         {
+                                             auto result = pool_bench::execute_benchmark(
+                                                 *pool, *suites[k], nullptr, settings.fork_sample);
+                                             shared[k] = result.fork + result.join;
+                                             counted[k] = result.tasks;
+                                         }
+                                         catch(std::exception const& e)
+                                         {
+                                             errors[k] = e.what();
+                                         }
+                                     });
+            }
+            auto makespan_start = chrono::steady_clock::now();
+            release.set_value();
+            for(auto& i : threads)
+                i.join();
+            auto makespan = chrono::steady_clock::now() - makespan_start;
+
+            for(auto& i : errors)
+            {
+                if(!i.empty())
+                    throw std::runtime_error(i);
+            }
+
+            std::cout << pool->name() << std::endl;
+            printf(header_format.c_str(), "< problem >", "< alone >", "< shared >", "< slowdown >");
+            size_t tasks = 0;
+            auto slowest = 0.0;
+            auto fastest = std::numeric_limits<double>::max();
+            for(size_t k = 0; k < suites.size(); ++k)
+            {
+                auto slowdown = format_time(shared[k]) / std::max(format_time(alone[k]), 1e-9);
+                slowest = std::max(slowest, slowdown);
+                fastest = std::min(fastest, slowdown);
+                tasks += counted[k];
+                printf(report_format.c_str(),
+                       suites[k]->name(),
+                       format_time(alone[k]),
+                       format_time(shared[k]),
+                       slowdown);
+
+                if(!suites[k]->check_result())
+                {
+                    std::string err = "Error: Incorrect computation result while running \""s
+                        + std::string(suites[k]->name()) + "\" concurrently on \""s
+                        + std::string(pool->name()) + "\"\n"s;
+                    throw std::runtime_error(err);
+                }
+            }
+            auto sequential = std::accumulate(alone.begin(), alone.end(), chrono::nanoseconds(0));
+            printf("    makespan %fms, %.2fx over one after another, %.0f tasks/s, "
+                   "slowdown spread %.2fx\n\n",
+                   format_time(makespan),
+                   format_time(sequential) / std::max(format_time(makespan), 1e-9),
+                   tasks / chrono::duration<double>(makespan).count(),
+                   slowest / fastest);
+
+            pool->teardown();
+        }
+
+        for(auto& i : suites)
+        {
+            std::cout << "-- tearing down " << i->name() << std::endl;
+            i->teardown();
+        }
     }
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    auto settings = pool_bench::parse_options(argc, argv);
+
     std::cout << "***  thread pool benchmark  ***" << std::endl;
     std::cout << "-- Found " << pool_bench::get_runners().size() 
               << " registered subjects"
@@ -157,6 +1000,42 @@ int main()
     std::cout << "-- Found " << pool_bench::get_suites().size()
               << " registered benchmark problems"
               << std::endl;
-    pool_bench::run_benchmarks(pool_bench::get_suites(), pool_bench::get_runners());
+    if(settings.isolate)
+        std::cout << "-- Running every subject in its own process" << std::endl;
+    auto& clock = pool_bench::tick_clock::get();
+    std::cout << "-- Fork timer: " << (clock.is_tsc() ? "tsc" : "steady_clock")
+              << ", " << clock.ns_per_tick() << "ns per tick, "
+              << clock.overhead() * clock.ns_per_tick() << "ns overhead per reading";
+    if(settings.fork_sample > 1)
+        std::cout << ", sampling 1 in " << settings.fork_sample << " submissions";
+    std::cout << std::endl;
+    if(settings.memory && !pool_bench::memory::counting())
+        std::cout << "-- Allocations are not counted, configure with -DWITH_ALLOCATION_COUNTER=ON"
+                  << std::endl;
+    if(!settings.trace_directory.empty())
+        std::cout << "-- Writing task traces to " << settings.trace_directory << std::endl;
+    pool_bench::worker_override() = settings.workers;
+    if(settings.workers > 0)
+    {
+        std::cout << "-- Starting " << settings.workers << " workers per pool where possible, on "
+                  << std::thread::hardware_concurrency() << " cores" << std::endl;
+        for(auto& i : pool_bench::get_runners())
+        {
+            if(!i->takes_worker_count())
+                std::cout << "-- " << i->name() << " sizes itself and ignores --workers" << std::endl;
+        }
+    }
+    pool_bench::resolve_loads(settings.loads, pool_bench::get_runners(), pool_bench::get_suites());
+    for(auto& i : settings.loads)
+        std::cout << "-- Co-tenant load: " << i.describe() << std::endl;
+    if(!settings.concurrent.empty())
+    {
+        auto suites = pool_bench::select_suites(pool_bench::get_suites(), settings.concurrent);
+        std::cout << "-- Running " << suites.size() << " problems concurrently on every subject"
+                  << std::endl;
+        pool_bench::run_concurrent(suites, pool_bench::get_runners(), settings);
+        return 0;
+    }
+    pool_bench::run_benchmarks(pool_bench::get_suites(), pool_bench::get_runners(), settings);
     return 0;
 }